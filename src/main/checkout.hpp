@@ -1,7 +1,10 @@
 #pragma once
 
 #include "routine.hpp"
+#include "io/reader/header_cache_reader.hpp"
 #include "io/reader/header_reader.hpp"
+#include "io/reader/prepared_reader.hpp"
+#include "io/writer/header_cache_writer.hpp"
 #include "model/header.hpp"
 
 #include "util/log.hpp"
@@ -22,11 +25,33 @@ class Checkout : public Routine
      */
     fs::path m_input;
 
+    /**
+     * The fast mode flag. If set, only the relations of the input file are
+     * read.
+     */
+    bool m_fast;
+
     /**
     * The logger.
     */
     util::Logger<std::ostream> m_log{ std::cout };
 
+    /* Helper Methods */
+
+    void write_header_cache(model::Header header)
+    {
+        // The cache is optional, so failing to write it is not an error
+        try
+        {
+            io::HeaderCacheWriter writer{ m_input };
+            writer.write(std::move(header));
+        }
+        catch (const std::exception& e)
+        {
+            m_log.warn() << "Could not cache the header of file " << m_input << ": " << e.what() << '\n';
+        }
+    }
+
 public:
 
     /* Constructors */
@@ -34,7 +59,8 @@ public:
     Checkout() : Routine()
     {
         m_options.add_options()
-            ("input", po::value<fs::path>()->required(), "Sets the input file path.\nAllowed file formats: .osm, .pbf")
+            ("input", po::value<fs::path>()->required(), "Sets the input file path.\nAllowed file formats: .osm, .pbf, .wzb")
+            ("fast", po::bool_switch()->default_value(false), "Only reads the relations of the input file.\nThe bounds are taken from the file header and nodes and ways are not counted.")
             ("help,h", "Shows this help message");
         m_positional.add("input", 1);
     }
@@ -50,6 +76,7 @@ public:
     {
         Routine::setup();
         this->set<fs::path>(&m_input, "input", util::validate_file);
+        this->set<bool>(&m_fast, "fast");
         m_log.set_steps(1);
     }
 
@@ -57,8 +84,24 @@ public:
     {       
         // Read the file info of the specified input file
         m_log.start() << "Reading headers from file " << m_input << ".\n";
-        io::HeaderReader reader{ m_input.string() };
-        model::Header header = reader.read();
+        model::Header header;
+        io::HeaderCacheReader cache_reader{ m_input };
+        if (io::prepared::is_prepared(m_input))
+        {
+            io::PreparedHeaderReader reader{ m_input };
+            header = reader.read();
+        }
+        else if (cache_reader.valid(!m_fast))
+        {
+            // Reuse the cached header if the input file did not change since
+            header = cache_reader.read();
+        }
+        else
+        {
+            io::HeaderReader reader{ m_input.string(), m_fast };
+            header = reader.read();
+            write_header_cache(header);
+        }
         m_log.finish();
 
         util::print(std::cout, header);
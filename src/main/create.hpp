@@ -1,13 +1,25 @@
 #pragma once
 
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <regex>
+#include <sstream>
+#include <tuple>
+
 #include "routine.hpp"
 
-#include "model/graph/undirected_graph.hpp"
+#include "model/graph/components.hpp"
+#include "model/graph/compressed_graph.hpp"
 #include "model/boundary.hpp"
 #include "model/types.hpp"
 
+#include "io/reader/header_cache_reader.hpp"
 #include "io/reader/header_reader.hpp"
 #include "io/reader/osm_reader.hpp"
+#include "io/reader/prepared_reader.hpp"
+#include "io/writer/header_cache_writer.hpp"
 #include "io/writer/map_writer.hpp"
 #include "io/writer/mapdata_writer.hpp"
 
@@ -22,7 +34,9 @@
 
 #include "functions/transform.hpp"
 
+#include "util/insert.hpp"
 #include "util/log.hpp"
+#include "util/table.hpp"
 #include "util/title.hpp"
 #include "util/validate.hpp"
 
@@ -47,11 +61,11 @@ class Create : public Routine
 
     using buffer_t = osmium::memory::Buffer;
 
-    using graph_t = graph::UndirectedGraph;
+    using graph_t = graph::CompressedGraph;
 
-    using component_t = std::vector<std::set<osmium::object_id_type>>;
+    using component_t = graph::Components;
 
-    using container_t = std::map<object_id_type, Boundary<T>>;
+    using container_t = BoundaryMap<T>;
 
     using hierarchy_t = std::map<object_id_type, std::set<object_id_type>>;
 
@@ -88,15 +102,52 @@ class Create : public Routine
     int m_height;
 
     /**
-     * The compression distance tolerance for the Douglas-Peucker algorithm.
+     * The compression distance tolerances for the Douglas-Peucker algorithm.
+     * If multiple tolerances are specified, one map is created for each
+     * combination of compression and filter tolerances.
+     */
+    std::vector<double> m_compression_tolerances;
+
+    /**
+     * The surface area tolerances for the filter algorithm.
+     */
+    std::vector<double> m_filter_tolerances;
+
+    /**
+     * The hierarchy mode. In topology mode, the hierarchy is derived from the
+     * nodes that the boundaries share and only ambiguous boundaries are
+     * compared geometrically. In geometry mode, all boundaries are compared
+     * geometrically.
+     */
+    std::string m_hierarchy_mode;
+
+    /**
+     * Whether the pole of inaccessibility is used as the center of
+     * boundaries whose centroid lies outside of them.
+     */
+    bool m_polylabel;
+
+    /**
+     * The compression distance tolerance of the current map.
      */
     double m_compression_tolerance;
 
     /**
-     * The surface area tolerance for the filter algorithm.
+     * The surface area tolerance of the current map.
      */
     double m_filter_tolerance;
 
+    /**
+     * The number of worker threads.
+     */
+    std::size_t m_threads;
+
+    /**
+     * The mapping of a prepared boundary input file, which is referenced by
+     * the boundary buffer and has to be kept until the buffer is freed.
+     */
+    std::shared_ptr<io::prepared::PreparedFile> m_mapping;
+
    /**
     * The verbose logging flag.
     */
@@ -114,14 +165,17 @@ public:
     Create() : Routine()
     {
         m_options.add_options()
-            ("input", po::value<fs::path>()->required(), "Sets the input file path.\nAllowed file formats: .osm, .pbf")
+            ("input", po::value<fs::path>()->required(), "Sets the input file path.\nAllowed file formats: .osm, .pbf, .wzb")
             ("outdir,o", po::value<fs::path>()->default_value(""), "Sets the output folder for the generated map files.")
             ("territory-level,t", po::value<level_type>()->default_value(0), "Sets the admin_level of boundaries that will be be used as territories.\nInteger between 1 and 12.")
             ("bonus-levels,b", po::value<std::vector<level_type>>()->multitoken(), "Sets the admin_level of boundaries that will be be used as bonus links.\nInteger between 1 and 12. If none are specified, no bonus links will be generated.")
             ("width", po::value<int>()->default_value(1000), "Sets the generated map width in pixels.\nIf set to 0, the width will be determined automatically with the height.")
             ("height", po::value<int>()->default_value(0), "Sets the generated map height in pixels.\nIf set to 0, the height will be determined automatically with the width.")
-            ("compression-tolerance,c", po::value<double>()->default_value(0.0), "Sets the minimum distance tolerance for the compression algorithm.\nIf set to 0, no compression will be applied.")
-            ("filter-tolerance,f", po::value<double>()->default_value(0.0), "Sets the surface area ratio tolerance for filtering boundaries.\nIf set to 0, no filter will be applied.")
+            ("compression-tolerance,c", po::value<std::vector<double>>()->multitoken()->default_value(std::vector<double>{ 0.0 }, "0"), "Sets the minimum distance tolerance for the compression algorithm.\nIf set to 0, no compression will be applied. If multiple tolerances are specified, one map is created for each combination of tolerances.")
+            ("filter-tolerance,f", po::value<std::vector<double>>()->multitoken()->default_value(std::vector<double>{ 0.0 }, "0"), "Sets the surface area ratio tolerance for filtering boundaries.\nIf set to 0, no filter will be applied. If multiple tolerances are specified, one map is created for each combination of tolerances.")
+            ("hierarchy-mode", po::value<std::string>()->default_value("geometry"), "Sets the mode for calculating the hierarchy of territories and bonuses.\nAllowed values: topology, geometry. The topology mode derives the hierarchy from shared nodes and only compares ambiguous boundaries geometrically.")
+            ("polylabel", po::bool_switch()->default_value(false), "Uses the pole of inaccessibility as the center of boundaries whose centroid lies outside of them.")
+            ("threads,j", po::value<std::size_t>()->default_value(0), "Sets the number of worker threads.\nIf set to 0, the number of hardware threads will be used.")
             ("verbose", po::bool_switch()->default_value(false), "Enables verbose logging.")
             ("help,h", "Shows this help message.");
         m_positional.add("input", 1);
@@ -146,14 +200,35 @@ public:
         this->set<int>(&m_width, "width");
         this->set<int>(&m_height, "height");
         util::validate_dimensions(m_width, m_height);
-        this->set<double>(&m_compression_tolerance, "compression-tolerance", util::validate_epsilon);
-        this->set<double>(&m_filter_tolerance, "filter-tolerance", util::validate_epsilon);
+        this->set<std::vector<double>>(&m_compression_tolerances, "compression-tolerance");
+        for (double& tolerance : m_compression_tolerances)
+        {
+            util::validate_epsilon(tolerance, "compression-tolerance");
+        }
+        this->set<std::vector<double>>(&m_filter_tolerances, "filter-tolerance");
+        for (double& tolerance : m_filter_tolerances)
+        {
+            util::validate_epsilon(tolerance, "filter-tolerance");
+        }
+        m_compression_tolerance = m_compression_tolerances.front();
+        m_filter_tolerance = m_filter_tolerances.front();
+        this->set<std::string>(&m_hierarchy_mode, "hierarchy-mode", util::validate_hierarchy_mode);
+        this->set<bool>(&m_polylabel, "polylabel");
+        this->set<std::size_t>(&m_threads, "threads");
         this->set<bool>(&m_verbose, "verbose");
         // fs::create_directory(m_dir / "out");#
-        // Calculate the total number of steps for the routine
-        std::size_t steps = 10 + (m_compression_tolerance > 0.0)
-                    + (m_filter_tolerance > 0.0)
-                    + (!m_bonus_levels.empty());
+        // Calculate the total number of steps for the routine. The first two
+        // steps are shared by all tolerances, the steps up to the hierarchy
+        // by all filter tolerances of a compression tolerance.
+        std::size_t steps = 2;
+        for (double compression_tolerance : m_compression_tolerances)
+        {
+            steps += 4 + (compression_tolerance > 0.0) + (!m_bonus_levels.empty());
+            for (double filter_tolerance : m_filter_tolerances)
+            {
+                steps += 2 + (filter_tolerance > 0.0);
+            }
+        }
         m_log.set_steps(steps);
     }
 
@@ -161,70 +236,225 @@ private:
 
     /* Helper methods */
 
-    Header read_header(const fs::path& file_path)
+    std::optional<Header> read_header(const fs::path& file_path, bool required)
+    {
+        // Prepared boundary files store their header, so that only the
+        // header has to be mapped
+        if (io::prepared::is_prepared(file_path))
+        {
+            io::PreparedHeaderReader reader{ file_path };
+            return reader.read();
+        }
+        // Reuse the cached header if the input file did not change since
+        io::HeaderCacheReader cache_reader{ file_path };
+        if (cache_reader.valid())
+        {
+            return cache_reader.read();
+        }
+        // Otherwise, the header is collected while reading the boundaries,
+        // unless it is needed before. Only the level distribution is
+        // needed here, so the relations are sufficient.
+        if (!required)
+        {
+            return std::nullopt;
+        }
+        io::HeaderReader reader{ file_path.string(), true };
+        Header header = reader.read();
+        write_header_cache(file_path, header);
+        return header;
+    }
+
+    void write_header_cache(const fs::path& file_path, Header header)
     {
-        // Prepare the header reader for the input file and retrieve the header
-        io::HeaderReader reader{ file_path.string() };
-        return reader.read();
+        // The cache is optional, so failing to write it is not an error
+        try
+        {
+            io::HeaderCacheWriter writer{ file_path };
+            writer.write(std::move(header));
+        }
+        catch (const std::exception& e)
+        {
+            m_log.warn() << "Could not cache the header of file " << file_path << ": " << e.what() << '\n';
+        }
     }
 
     osmium::memory::Buffer read_data(const fs::path& file_path, std::set<level_type> levels)
     {
+        // Load prepared boundary files without decoding them
+        if (io::prepared::is_prepared(file_path))
+        {
+            io::PreparedReader reader{ file_path, levels };
+            osmium::memory::Buffer buffer = reader.read();
+            m_mapping = reader.file();
+            return buffer;
+        }
         // Retrieve the administrative boundaries with and admin_level that
         // matches the prepared level filter from the input file
-        io::BoundaryReader reader{ m_input, levels };
-        return reader.read();
+        io::BoundaryReader reader{ file_path, levels, m_threads };
+        osmium::memory::Buffer buffer = reader.read();
+        // Cache the header that was collected along the way
+        if (!io::HeaderCacheReader{ file_path }.valid(true))
+        {
+            write_header_cache(file_path, reader.header());
+        }
+        return buffer;
     }
 
-    void compress(buffer_t& buffer)
+    std::string suffix(double compression_tolerance, double filter_tolerance)
     {
-        // Count the nodes before the compression
-        mapmaker::NodeCounter counter;
-        std::size_t before = counter.run(buffer);
+        std::ostringstream ss;
+        ss << "-c" << compression_tolerance << "-f" << filter_tolerance;
+        return ss.str();
+    }
 
+    long elapsed(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::pair<buffer_t, std::size_t> compress(mapmaker::Compressor& compressor, std::size_t before)
+    {
         // Compress the extracted ways using the specified compression
         // tolerance
-        mapmaker::Compressor compressor{ m_compression_tolerance };
-        compressor.run(buffer);
+        buffer_t buffer = compressor.run(m_compression_tolerance);
 
         // Count the nodes after the compression
-        std::size_t after = counter.run(buffer);
+        std::size_t after = mapmaker::NodeCounter{}.run(buffer);
 
         m_log.step() << "Compressed " << before << " nodes to " << after << " nodes.\n";
+        return { std::move(buffer), after };
     }
 
-    void assemble(buffer_t& buffer, std::set<level_type> levels, bool split)
+    std::pair<graph_t, component_t> get_neighbors(const buffer_t& buffer, level_type level)
     {
-        // Create the assembler depending on the split strategy.
-        mapmaker::Assembler assembler{ levels, split };
-        assembler.run(buffer);
+        // The connected components are determined in the same pass
+        mapmaker::NeighborInspector inspector{ level };
+        graph_t neighbors = inspector.run(buffer);
+        return { std::move(neighbors), inspector.components() };
     }
+    
+    std::set<object_id_type> filter(mapmaker::AreaFilter& filter, const buffer_t& buffer, const component_t& components)
+    {
+        // Count the areas before the filter process
+        mapmaker::AreaCounter counter;
+        std::size_t before = counter.run(buffer);
+
+        // Apply the area filter on the area buffer using the specified
+        // tolerance. The filter does not modify the area buffer, but returns
+        // the removed areas and rebuilds the areas that lose some of their
+        // rings into a separate buffer.
+        filter.tolerance(m_filter_tolerance);
+        std::set<object_id_type> removed = filter.run(components);
 
-    graph_t get_neighbors(const buffer_t& buffer, level_type level)
+        m_log.step() << "Filtered " << before << " areas to " << before - removed.size() << " areas.\n";
+        return removed;
+    }
+
+    /**
+     * Creates the boundaries of a filtered map from the boundaries of all
+     * areas. The removed boundaries are skipped and the rebuilt boundaries
+     * replace the boundaries with the same ids.
+     */
+    container_t apply_filter(const container_t& boundaries, const std::set<object_id_type>& removed, container_t&& rebuilt)
     {
-        mapmaker::NeighborInspector inspector{ level };
-        return inspector.run(buffer);
+        std::vector<container_t::value_type> entries;
+        entries.reserve(boundaries.size() + rebuilt.size());
+        for (const auto& entry : boundaries)
+        {
+            if (!removed.count(entry.first))
+            {
+                entries.push_back(entry);
+            }
+        }
+        for (auto& entry : rebuilt)
+        {
+            entries.push_back(std::move(entry));
+        }
+        return container_t{ std::move(entries) };
     }
 
-    component_t get_components(const graph_t& neighbors)
+    /**
+     * Removes the removed boundaries from the hierarchy. The rebuilt
+     * boundaries only lose the rings of removed boundaries, so that they
+     * keep their remaining children and parents.
+     */
+    hierarchy_t apply_filter(const hierarchy_t& hierarchy, const std::set<object_id_type>& removed)
     {
-        mapmaker::ComponentInspector inspector;
-        return inspector.run(neighbors);
+        hierarchy_t result;
+        for (const auto& [parent, children] : hierarchy)
+        {
+            if (removed.count(parent))
+            {
+                continue;
+            }
+            for (const object_id_type& child : children)
+            {
+                if (!removed.count(child))
+                {
+                    util::insert(result, parent, child);
+                }
+            }
+        }
+        return result;
     }
-    
-    void filter(buffer_t& buffer, graph_t& neighbors, component_t& components){
-        // Count the areas before the filter process
-        mapmaker::AreaCounter counter;
-        std::size_t before = counter.run(buffer);
 
-        // Apply the area filter on the area buffer using the specified tolerance
-        mapmaker::AreaFilter filter{ m_filter_tolerance };
-        filter.run(buffer, neighbors, components);
+    /**
+     * Fits the boundaries of a filtered map into the map dimensions, as
+     * the removed boundaries may have extended the bounds of the map. A
+     * dimension that is set to auto is calculated from the remaining
+     * bounds like in the conversion.
+     */
+    void fit(container_t& boundaries)
+    {
+        if (boundaries.empty())
+        {
+            return;
+        }
+        std::numeric_limits<T> limits;
+        geometry::Rectangle<T> bounds{ limits.max(), limits.max(), -limits.max(), -limits.max() };
+        for (const auto& [id, boundary] : boundaries)
+        {
+            bounds.min().x() = std::min(bounds.min().x(), boundary.bounds.min().x());
+            bounds.min().y() = std::min(bounds.min().y(), boundary.bounds.min().y());
+            bounds.max().x() = std::max(bounds.max().x(), boundary.bounds.max().x());
+            bounds.max().y() = std::max(bounds.max().y(), boundary.bounds.max().y());
+        }
 
-        // Count the nodes after the filter process
-        std::size_t after = counter.run(buffer);
+        // Check if a dimension is set to auto and calculate its value
+        // depending on the remaining bounds
+        if (m_width == 0 || m_height == 0)
+        {
+            if (m_width == 0)
+            {
+                m_width = bounds.width() / bounds.height() * m_height;
+            }
+            else
+            {
+                m_height = bounds.height() / bounds.width() * m_width;
+            }
+        }
 
-        m_log.step() << "Compressed " << before << " nodes to " << after << " nodes.\n";
+        // Map the remaining bounds to the map dimensions
+        auto transformation = functions::compose<T>(functions::IntervalTransformation<T>{
+            { bounds.min().x(), bounds.max().x() },
+            { bounds.min().y(), bounds.max().y() },
+            { 0, m_width },
+            { 0, m_height }
+        });
+        for (auto& [id, boundary] : boundaries)
+        {
+            for (geometry::Polygon<T>& polygon : boundary.geometry.polygons())
+            {
+                transformation.transform(polygon.outer().data(), polygon.outer().data() + polygon.outer().size());
+                for (geometry::Ring<T>& inner : polygon.inners())
+                {
+                    transformation.transform(inner.data(), inner.data() + inner.size());
+                }
+            }
+            transformation.transform(boundary.bounds.min().x(), boundary.bounds.min().y());
+            transformation.transform(boundary.bounds.max().x(), boundary.bounds.max().y());
+            transformation.transform(boundary.center.x(), boundary.center.y());
+        }
     }
     
     template <typename T>
@@ -234,13 +464,12 @@ private:
         transformation.transform(bounds.max().x(), bounds.max().y());
     }
 
-    container_t convert(buffer_t& buffer)
+    container_t convert(const buffer_t& buffer, geometry::Rectangle<T> bounds)
     {     
         // Prepare the transformations that will be applied on the buffer before
-        // the geometry conversion. At first, calculate the bounding box of the
-        // nodes in the buffer.
-        mapmaker::BoundsCalculator<T> bounds_calculator{};
-        geometry::Rectangle<T> bounds = bounds_calculator.run(buffer);
+        // the geometry conversion. The bounding box of all areas is specified,
+        // so that the areas of several buffers can be converted for the same
+        // map.
 
         // The radian transformation converts the nodes, for which the locations
         // are specified in degrees, to radians, for futher usage in the Mercator
@@ -282,27 +511,39 @@ private:
         functions::ScaleTransformation<T> scale_transformation{ (double) m_width, (double) m_height };
 
         // Create the converter, which will apply the specified transformations
-        // and convert the areas to multipolygon geometries afterwards.
-        mapmaker::BoundaryConverter<T> converter{
-            std::make_shared<functions::RadianTransformation<T>>(radian_transformation),
-            std::make_shared<functions::MercatorProjection<T>>(mercator_transformation),
-            std::make_shared<functions::UnitTransformation<T>>(normalize_transformation),
-            // std::make_shared<functions::MirrorTransformation<T>>(mirror_transformation),
-            std::make_shared<functions::ScaleTransformation<T>>(scale_transformation)
-        };
+        // and convert the areas to multipolygon geometries afterwards. The
+        // transformations are composed at compile time, so that they are
+        // applied in a single pass over the coordinates of each ring.
+        auto transformation = functions::compose<T>(
+            radian_transformation,
+            mercator_transformation,
+            normalize_transformation,
+            // mirror_transformation,
+            scale_transformation
+        );
+        mapmaker::BoundaryConverter<T, decltype(transformation)> converter{ transformation, m_threads };
         return converter.run(buffer);
     }
 
     void calculate_centers(container_t& boundaries)
     {
-        mapmaker::CenterCalculator<T> calculator;
+        mapmaker::CenterCalculator<T> calculator{ m_polylabel };
         calculator.run(boundaries);
     }
 
-    hierarchy_t calculate_hierarchy(const container_t& boundaries)
+    hierarchy_t calculate_hierarchy(const buffer_t& buffer, const container_t& boundaries)
     {
         mapmaker::HierarchyInspector<T> inspector;
-        return inspector.run(boundaries);
+        if (m_hierarchy_mode == "geometry")
+        {
+            return inspector.run(boundaries);
+        }
+        // Derive the hierarchy from the shared nodes of the areas first and
+        // only compare the geometries of the ambiguous boundaries
+        mapmaker::TopologyHierarchyInspector topology_inspector;
+        hierarchy_t hierarchy = topology_inspector.run(buffer, boundaries);
+        m_log.step() << "Resolving " << topology_inspector.ambiguous().size() << " ambiguous boundaries geometrically.\n";
+        return inspector.run(boundaries, hierarchy, topology_inspector.ambiguous());
     }
     
     warzone::Map<T> build_map(std::string name, container_t& boundaries, const graph_t& neighbors, const hierarchy_t& hierarchy)
@@ -353,10 +594,10 @@ public:
         // Step 1: Read the file header and determine the territory level
         // automatically if it was not set.
         m_log.start() << "Retrieving headers from file " << m_input << ".\n";
-        Header header = read_header(m_input);
+        std::optional<Header> header = read_header(m_input, m_territory_level == 0);
         if (m_territory_level == 0)
         {
-            auto [l, c] = *std::max_element(header.levels.cbegin(), header.levels.cend(),
+            auto [l, c] = *std::max_element(header->levels.cbegin(), header->levels.cend(),
                 [](const std::pair<short, std::size_t>& e1, const std::pair<short, std::size_t>& e2)
                 {
                     return e1.second < e2.second;
@@ -376,91 +617,170 @@ public:
         buffer_t buffer = read_data(m_input, levels);
         m_log.finish();
 
-        // Step 3: Compress the extracted ways using the Douglas-Peucker
-        // algorithm if a compression threshold was specified.
-        if (m_compression_tolerance > 0)
-        {
-            m_log.start() << "Compressing ways with tolerance " << m_compression_tolerance << ".\n";
-            compress(buffer);
-            m_log.finish();
-        }
+        // Create the map name from the input file name
+        std::string name = std::regex_replace(
+            m_input.filename().string(),
+            std::regex("(\\.osm|\\.pbf|\\.wzb)"),
+            ""
+        );
 
-        // Step 4: Assemble the territory boundaries using the built-in
-        // multipolygon assembler.
-        m_log.start() << "Assembling territories with level " << m_territory_level << ".\n";
-        assemble(buffer, { m_territory_level }, true);
-        m_log.finish();
-        
-        // Step 5: Create the neighbor graph for the assembled territories.
-        m_log.start() << "Calculating neighborships for territories.\n";
-        graph::UndirectedGraph neighbors = get_neighbors(buffer, m_territory_level);
-        m_log.finish();
+        // Create one map for each combination of tolerances. The boundaries
+        // are only read once. The converted boundaries, their centers and
+        // their hierarchy are reused for all filter tolerances, so that only
+        // the filter and the map creation are repeated.
+        bool sweep = m_compression_tolerances.size() * m_filter_tolerances.size() > 1;
+        util::Table<double, double, std::size_t, std::size_t, std::size_t, long, long> summary{
+            { "Compression", "Filter", "Nodes", "Territories", "Bonuses", "Assembly (ms)", "Map (ms)" }
+        };
+        int width = m_width;
+        int height = m_height;
+
+        // The boundaries are never changed, so that they are shared by all
+        // compression tolerances. The compressor splits the ways into arcs
+        // only once and the assembler determines the areas to be assembled
+        // only once, as the compressed buffers contain the same ways and
+        // relations in the same order.
+        mapmaker::Compressor compressor{ buffer, m_threads };
+        mapmaker::Assembler assembler{ levels, { m_territory_level }, m_threads };
+        std::size_t total_nodes = mapmaker::NodeCounter{}.run(buffer);
+        for (std::size_t i = 0; i < m_compression_tolerances.size(); i++)
+        {
+            auto assembly_start = std::chrono::steady_clock::now();
+            m_compression_tolerance = m_compression_tolerances.at(i);
+
+            // Step 3: Compress the extracted ways using the Douglas-Peucker
+            // algorithm if a compression threshold was specified.
+            buffer_t compressed{};
+            std::size_t nodes = total_nodes;
+            if (m_compression_tolerance > 0)
+            {
+                m_log.start() << "Compressing ways with tolerance " << m_compression_tolerance << ".\n";
+                std::tie(compressed, nodes) = compress(compressor, total_nodes);
+                m_log.finish();
+            }
 
-        // Step 6: Calculate the connected components for the neighbor graph.
-        // This yields the islands of the map.
-        m_log.start() << "Finding territory islands.\n";
-        component_t components = get_components(neighbors);
-        m_log.finish();
+            // Step 4: Assemble the territory and bonus boundaries in a single
+            // pass using the built-in multipolygon assembler. Only the
+            // territories are split into their polygons.
+            if (m_bonus_levels.empty())
+            {
+                m_log.start() << "Assembling territories with level " << m_territory_level << ".\n";
+            }
+            else
+            {
+                m_log.start() << "Assembling territories with level " << m_territory_level
+                              << " and bonuses with the levels " << util::join(m_bonus_levels) << ".\n";
+            }
+            buffer_t areas = assembler.run(m_compression_tolerance > 0 ? compressed : buffer);
+            // The later steps only need the assembled areas, so the compressed
+            // nodes, ways and relations are freed
+            compressed = buffer_t{};
+            m_log.finish();
+            
+            // Step 5: Create the neighbor graph for the assembled territories
+            // and calculate its connected components along the way. This yields
+            // the islands of the map.
+            m_log.start() << "Calculating neighborships and islands for territories.\n";
+            auto [neighbors, components] = get_neighbors(areas, m_territory_level);
+            m_log.finish();
 
-        // Step 7: Filter connected components by their surface area if a filter
-        // threshold was specified.
-        if (m_filter_tolerance > 0)
-        {
-            m_log.start() << "Compressing ways with tolerance " << m_filter_tolerance << ".\n";
-            filter(buffer, neighbors, components);
+            // Step 6: Create the boundary geometries from the assembled boundaries by
+            // applying the map projections and transformations first and converting
+            // the osmium objects to geometry objects afterwards. The boundaries
+            // are converted once for all filter tolerances.
+            m_log.start() << "Building the boundary geometries from the OpenStreetMap objects.\n";
+            m_width = width;
+            m_height = height;
+            geometry::Rectangle<T> bounds = mapmaker::BoundsCalculator<T>{}.run(areas);
+            container_t boundaries = convert(areas, bounds);
+            int map_width = m_width;
+            int map_height = m_height;
             m_log.finish();
-        }
 
-        // Step 8: Assemble the bonus boundarties using the built-in multipolygon
-        // assembler if any bonus levels were specified.
-        if (!m_bonus_levels.empty())
-        {
-            m_log.start() << "Assembling bonuses with the levels " << util::join(m_bonus_levels) << ".\n";
-            assemble(buffer, std::set<level_type>(m_bonus_levels.begin(), m_bonus_levels.end()), false);
+            // Step 7: Calculate the center points for each boundary
+            m_log.start() << "Calculating the center points for " << boundaries.size() << " boundaries.\n";
+            calculate_centers(boundaries);
             m_log.finish();
+
+            // Step 8: Calculate the hirarchy of territories, bonuses and super bonuses
+            // if any bonus levels were specified.
+            hierarchy_t hierarchy = {};
+            if (!m_bonus_levels.empty())
+            {
+                m_log.start() << "Calculating the hierarchy for " << boundaries.size() << " boundaries.\n";
+                hierarchy = calculate_hierarchy(areas, boundaries);
+                m_log.finish();
+            }
+            long assembly_duration = elapsed(assembly_start);
+
+            // The filter calculates the surface areas of the areas once, so
+            // that it is reused for all filter tolerances
+            mapmaker::AreaFilter area_filter{ areas };
+            for (std::size_t j = 0; j < m_filter_tolerances.size(); j++)
+            {
+                auto map_start = std::chrono::steady_clock::now();
+                m_filter_tolerance = m_filter_tolerances.at(j);
+                m_width = map_width;
+                m_height = map_height;
+
+                // Step 9: Filter connected components by their surface area if a filter
+                // threshold was specified. The filter does not change the areas and
+                // the neighbor graph, so that only the removed boundaries and the
+                // rebuilt boundaries differ from the unfiltered map.
+                std::set<object_id_type> removed = {};
+                container_t rebuilt = {};
+                if (m_filter_tolerance > 0)
+                {
+                    m_log.start() << "Filtering territory islands with tolerance " << m_filter_tolerance << ".\n";
+                    removed = filter(area_filter, areas, components);
+                    rebuilt = convert(area_filter.rebuilt(), bounds);
+                    calculate_centers(rebuilt);
+                    m_log.finish();
+                }
+                container_t map_boundaries = apply_filter(boundaries, removed, std::move(rebuilt));
+                if (!removed.empty())
+                {
+                    // The map dimensions are determined again for the
+                    // remaining boundaries
+                    m_width = width;
+                    m_height = height;
+                    fit(map_boundaries);
+                }
+
+                // Step 10: Build the map with the generated data. In sweep
+                // mode, the tolerances are appended to the map name.
+                m_log.start() << "Building the Warzone map.\n";
+                std::string map_name = sweep ? name + suffix(m_compression_tolerance, m_filter_tolerance) : name;
+                warzone::Map map = build_map(map_name, map_boundaries, neighbors, apply_filter(hierarchy, removed));
+                std::size_t territories = map.territories.size();
+                std::size_t bonuses = map.bonuses.size();
+                m_log.finish();
+
+                // Step 11: Export the generated Warzone map and the calculated mapdata
+                // to the specified output directory
+                m_log.start() << "Exporting the generated map files.\n";
+                export_map(warzone::Map<T>{ map });
+                export_mapdata(std::move(map));
+                m_log.finish();
+
+                summary.add_row(
+                    m_compression_tolerance,
+                    m_filter_tolerance,
+                    nodes,
+                    territories,
+                    bonuses,
+                    assembly_duration,
+                    elapsed(map_start)
+                );
+            }
         }
-        
-        // Step 9: Create the boundary geometries from the assembled boundaries by
-        // applying the map projections and transformations first and converting
-        // the osmium objects to geometry objects afterwards.
-        m_log.start() << "Building the boundary geometries from the OpenStreetMap objects.\n";
-        std::map<object_id_type, Boundary<T>> boundaries = convert(buffer);
-        m_log.finish();
-        
-        // Step 10: Calculate the center points for each boundary
-        m_log.start() << "Calculating the center points for " << boundaries.size() << " boundaries.\n";
-        calculate_centers(boundaries);
-        m_log.finish();
 
-        // Step 11: Calculate the hirarchy of territories, bonuses and super bonuses
-        // if any bonus levels were specified
-        hierarchy_t hierarchy = {};
-        if (!m_bonus_levels.empty())
+        // Print the summary of all maps in sweep mode
+        if (sweep)
         {
-            m_log.start() << "Calculating the hierarchy for " << boundaries.size() << " boundaries.\n";
-            hierarchy = calculate_hierarchy(boundaries);
-            m_log.finish();
+            summary.print(std::cout);
         }
 
-        // Step 12: Build the map with the generated data
-        m_log.start() << "Building the Warzone map.\n";
-        // Create the map name from the input file name
-        std::string name = std::regex_replace(
-            m_input.filename().string(),
-            std::regex("(\\.osm|\\.pbf)"),
-            ""
-        );
-        // Build the map
-        warzone::Map map = build_map(name, boundaries, neighbors, hierarchy);
-        m_log.finish();
-
-        // Step 13: Export the generated Warzone map and the calculated mapdata
-        // to the specified output directory
-        m_log.start() << "Exporting the generated map files.\n";
-        export_map(std::move(map));
-        export_mapdata(std::move(map));
-        m_log.finish();
-
         // Routine finished, print the total duration.
         m_log.end();
     }
@@ -2,10 +2,14 @@
 
 #include <cmath>
 #include <queue>
+#include <utility>
+#include <vector>
 
 #include "model/geometry/point.hpp"
 #include "model/geometry/rectangle.hpp"
-#include "model/geometry/polygon.hpp"
+
+#include "functions/center.hpp"
+#include "functions/prepared.hpp"
 
 using namespace model;
 
@@ -32,10 +36,10 @@ namespace functions
             Cell(
                 geometry::Point<T> center,
                 double half,
-                const geometry::Polygon<T>& polygon
+                const PreparedPolygon<T>& polygon
             ) : center(center), half(half)
             {
-                distance = distance_to_polygon(center, polygon);
+                distance = polygon.distance(center);
                 max = distance + half * SQRT_TWO;
             }
         };
@@ -43,51 +47,36 @@ namespace functions
         /* Functions */
 
         /**
+         * Calculates the pole of inaccessibility of a polygon, which is the
+         * point inside of the polygon with the maximum distance to its
+         * edges. The polygon is covered with cells, which are split until
+         * no cell can contain a better point than the best point found.
          *
-         * @param polygon
-         * @returns
-         */
-        template <typename T>
-        inline Cell<T> get_centroid(const geometry::Polygon<T>& polygon)
-        {
-            double area = 0;
-            geometry::Point<T> center;
-            for (std::size_t i = 0, j = polygon.outer().size() - 1; i < polygon.outer().size(); j = i++)
-            {
-                const geometry::Point<T>& left = polygon.outer().at(i);
-                const geometry::Point<T>& right = polygon.outer().at(j);
-                auto f = left.x() * right.y() - right.x() * left.y();
-                center.x() += (left.x() + right.x()) * f;
-                center.y() += (left.y() + right.y()) * f;
-                area += f * 3;
-            }
-            if (area > 0)
-            {
-                center /= area;
-                return Cell<T>{ center, 0, polygon } ;
-            }
-            return Cell<T>{ polygon.outer().at(0), 0, polygon };
-        }
-
-        /**
+         * For more information, refer to https://github.com/mapbox/polylabel
          *
+         * @param polygon   The prepared polygon
+         * @param guess     The first guess, such as the centroid
+         * @param precision The precision of the result
+         * @returns         The pole of inaccessibility and its distance to
+         *                  the edges of the polygon
          */
         template <typename T>
         inline std::pair<geometry::Point<T>, double> polylabel(
-            const geometry::Polygon<T>& polygon,
+            const PreparedPolygon<T>& polygon,
+            const geometry::Point<T>& guess,
             double precision = 1
         ) {
             using Cell = detail::Cell<T>;
 
-            // Calculate the polygon envelope, which is the minimal bounding
-            // box that enclosed the outer ring
-            const geometry::Rectangle<T> polygon_envelope = envelope(polygon);
+            // Retrieve the polygon envelope, which is the minimal bounding
+            // box that encloses the outer ring
+            const geometry::Rectangle<T>& polygon_envelope = polygon.bounds();
 
             // Scale the cells according to the envelope
             const T cell_size = std::min(polygon_envelope.width(), polygon_envelope.height());
             if (cell_size == 0)
             {
-                return std::make_pair(polygon_envelope.min(), 0);
+                return std::make_pair(polygon_envelope.min(), 0.0);
             }
             T half = cell_size / 2;
 
@@ -107,16 +96,16 @@ namespace functions
                 }
             }
 
-            // take centroid as the first best guess
-            Cell best_cell = detail::get_centroid(polygon);
-            
-            // second guess: bounding box centroid
-            Cell envelope_center_cell(center(polygon_envelope).first, 0, polygon);
+            // Take the guess as the first best cell
+            Cell best_cell{ guess, 0, polygon };
+
+            // Second guess: bounding box center
+            Cell envelope_center_cell{ center(polygon_envelope), 0, polygon };
             if (envelope_center_cell.distance > best_cell.distance)
             {
                 best_cell = envelope_center_cell;
             }
-            
+
             while (!queue.empty())
             {
                 // Pick the most promising cell from the top of the queue
@@ -149,4 +138,4 @@ namespace functions
 
     }
 
-}
\ No newline at end of file
+}
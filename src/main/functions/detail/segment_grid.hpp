@@ -0,0 +1,212 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "model/geometry/point.hpp"
+#include "model/geometry/rectangle.hpp"
+#include "model/geometry/ring.hpp"
+
+#include "functions/envelope.hpp"
+
+using namespace model::geometry;
+
+namespace functions
+{
+
+    namespace detail
+    {
+
+        /**
+         * A uniform grid over the segments of a ring. Each segment is stored
+         * in every cell that its bounding box overlaps, so that a query only
+         * has to test the segments of the cells that it overlaps instead of
+         * all segments of the ring.
+         *
+         * The ring is referenced, so it has to outlive the grid. Queries
+         * track the visited segments, so a grid must not be queried from
+         * several threads at once.
+         */
+        template <typename T>
+        class SegmentGrid
+        {
+        protected:
+
+            /* Members */
+
+            const Ring<T>& m_ring;
+            Rectangle<T> m_bounds;
+            std::size_t m_columns;
+            std::size_t m_rows;
+            double m_cell_width;
+            double m_cell_height;
+
+            /**
+             * The segment indices of all cells, which are stored
+             * consecutively in row-major order.
+             */
+            std::vector<std::size_t> m_segments;
+
+            /**
+             * The segment offsets of the cells, including the end offset.
+             */
+            std::vector<std::size_t> m_offsets;
+
+            /**
+             * The last query that visited each segment, which prevents
+             * segments spanning several cells from being visited twice.
+             */
+            mutable std::vector<std::size_t> m_visits;
+            mutable std::size_t m_query = 0;
+
+        public:
+
+            /* Constructors */
+
+            /**
+             * Creates the grid for a ring. The grid has about as many cells
+             * as the ring has segments.
+             *
+             * @param ring The ring
+             *
+             * Time complexity: Linear (Average-case)
+             */
+            SegmentGrid(const Ring<T>& ring)
+            : m_ring(ring), m_bounds(functions::envelope(ring)), m_columns(1), m_rows(1)
+            {
+                std::size_t count = size();
+                std::size_t cells = std::max(std::size_t(1), (std::size_t) std::sqrt((double) count));
+                m_columns = m_bounds.width() > 0 ? cells : 1;
+                m_rows = m_bounds.height() > 0 ? cells : 1;
+                m_cell_width = m_bounds.width() / m_columns;
+                m_cell_height = m_bounds.height() / m_rows;
+
+                // Count the segments of each cell first, so that the segment
+                // indices can be stored without reallocations
+                m_offsets.assign(m_columns * m_rows + 1, 0);
+                for (std::size_t i = 0; i < count; i++)
+                {
+                    visit_cells(m_ring[i], m_ring[i + 1], [&](std::size_t cell) { m_offsets[cell + 1]++; });
+                }
+                for (std::size_t cell = 0; cell < m_columns * m_rows; cell++)
+                {
+                    m_offsets[cell + 1] += m_offsets[cell];
+                }
+                m_segments.resize(m_offsets.back());
+                std::vector<std::size_t> positions{ m_offsets.begin(), m_offsets.end() - 1 };
+                for (std::size_t i = 0; i < count; i++)
+                {
+                    visit_cells(m_ring[i], m_ring[i + 1], [&](std::size_t cell) { m_segments[positions[cell]++] = i; });
+                }
+                m_visits.assign(count, 0);
+            }
+
+        protected:
+
+            /* Helper Methods */
+
+            std::size_t column(T x) const
+            {
+                if (m_cell_width <= 0 || x <= m_bounds.min().x())
+                {
+                    return 0;
+                }
+                return std::min(m_columns - 1, (std::size_t) ((x - m_bounds.min().x()) / m_cell_width));
+            }
+
+            std::size_t row(T y) const
+            {
+                if (m_cell_height <= 0 || y <= m_bounds.min().y())
+                {
+                    return 0;
+                }
+                return std::min(m_rows - 1, (std::size_t) ((y - m_bounds.min().y()) / m_cell_height));
+            }
+
+            /**
+             * Calls a function for each cell that overlaps the bounding box
+             * of two points.
+             */
+            template <typename Function>
+            void visit_cells(const Point<T>& p, const Point<T>& q, Function fn) const
+            {
+                std::size_t c_min = column(std::min(p.x(), q.x()));
+                std::size_t c_max = column(std::max(p.x(), q.x()));
+                std::size_t r_min = row(std::min(p.y(), q.y()));
+                std::size_t r_max = row(std::max(p.y(), q.y()));
+                for (std::size_t r = r_min; r <= r_max; r++)
+                {
+                    for (std::size_t c = c_min; c <= c_max; c++)
+                    {
+                        fn(r * m_columns + c);
+                    }
+                }
+            }
+
+        public:
+
+            /* Accessors */
+
+            /**
+             * Returns the number of segments of the ring.
+             */
+            std::size_t size() const
+            {
+                return m_ring.size() < 2 ? 0 : m_ring.size() - 1;
+            }
+
+            const Rectangle<T>& bounds() const
+            {
+                return m_bounds;
+            }
+
+            /* Methods */
+
+            /**
+             * Calls a predicate for each segment of the ring whose cells
+             * overlap the bounding box of the segment from p to q. Every
+             * segment is passed at most once. The search stops as soon as
+             * the predicate returns true.
+             *
+             * @param p         The first point of the query segment
+             * @param q         The last point of the query segment
+             * @param predicate The predicate, which receives the first and
+             *                  the last point of a ring segment
+             * @returns         True if the predicate returned true for any
+             *                  segment
+             *
+             * Time complexity: Linear in the number of visited segments
+             */
+            template <typename Predicate>
+            bool any(const Point<T>& p, const Point<T>& q, Predicate predicate) const
+            {
+                // Skip queries outside of the grid
+                if (std::max(p.x(), q.x()) < m_bounds.min().x() || std::min(p.x(), q.x()) > m_bounds.max().x()
+                    || std::max(p.y(), q.y()) < m_bounds.min().y() || std::min(p.y(), q.y()) > m_bounds.max().y())
+                {
+                    return false;
+                }
+                m_query++;
+                bool found = false;
+                visit_cells(p, q, [&](std::size_t cell)
+                {
+                    for (std::size_t i = m_offsets[cell]; !found && i < m_offsets[cell + 1]; i++)
+                    {
+                        std::size_t segment = m_segments[i];
+                        if (m_visits[segment] != m_query)
+                        {
+                            m_visits[segment] = m_query;
+                            found = predicate(m_ring[segment], m_ring[segment + 1]);
+                        }
+                    }
+                });
+                return found;
+            }
+
+        };
+
+    }
+
+}
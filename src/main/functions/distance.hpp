@@ -1,6 +1,8 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
 
 #include "model/geometry/point.hpp"
 #include "model/geometry/rectangle.hpp"
@@ -68,6 +70,34 @@ namespace functions
         return distance(ps, line_plumb);
     }
 
+    /**
+     * Calculate the distance of a point to a segment, defined by two
+     * points. Unlike the perpendicular distance, the distance to the
+     * nearest end point is returned if the plumb point lies outside
+     * of the segment.
+     *
+     * @param p  The point
+     * @param s1 The first point of the segment
+     * @param s2 The last point of the segment
+     * @return   The distance of the point to the segment
+     *
+     * Time complexity: Constant
+     */
+    template <typename T>
+    inline double segment_distance(const Point<T>& p, const Point<T>& s1, const Point<T>& s2)
+    {
+        Point<T> dir = s2 - s1;
+        double length = dot(dir, dir);
+        if (length == 0.0)
+        {
+            return distance(p, s1);
+        }
+        // Project the point onto the segment and clamp the projection to
+        // the end points
+        double t = std::clamp(dot(p - s1, dir) / length, 0.0, 1.0);
+        return distance(p, s1 + dir * t);
+    }
+
     /**
      * Calculate the minimal (signed) distance of to a ring.
      * 
@@ -83,11 +113,11 @@ namespace functions
     template <typename T>
     inline double distance(const Point<T>& p, const Ring<T>& ring)
     {       
-        bool inside;
-        double distance = DBL_MAX;
+        bool inside = false;
+        double distance = std::numeric_limits<double>::max();
         // Iterate over the ring segments and determine the minimum
         // distance between the point and any segment
-        for (std::size_t i = 0; i < ring.size(); i++)
+        for (std::size_t i = 0; i + 1 < ring.size(); i++)
         {
             const Point<T>& left = ring.at(i);
             const Point<T>& right = ring.at(i + 1);
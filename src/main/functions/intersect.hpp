@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <vector>
 
 #include "model/geometry/point.hpp"
@@ -9,7 +11,9 @@
 #include "model/geometry/polygon.hpp"
 
 #include "functions/envelope.hpp"
-#include "functions/detail/shamos_hoey.hpp"
+#include "functions/util.hpp"
+#include "functions/detail/compare.hpp"
+#include "functions/detail/segment_grid.hpp"
 
 using namespace model::geometry;
 
@@ -134,50 +138,143 @@ namespace functions
         return (s >= 0 && s <= 1 && t >= 0 && t <= 1);
     }
 
+    /**
+     * Calculates the orientation of a point r relative to the line through
+     * the points p and q, which is the cross product of (q - p) and (r - p).
+     *
+     * @param p The first point of the line
+     * @param q The second point of the line
+     * @param r The point
+     * @returns A positive value if r is left of the line, a negative value
+     *          if r is right of the line and 0 if r lies on the line
+     *
+     * Time complexity: Constant
+     */
+    template <typename T>
+    inline double orientation(const Point<T>& p, const Point<T>& q, const Point<T>& r)
+    {
+        return ((double) q.x() - p.x()) * ((double) r.y() - p.y())
+            - ((double) q.y() - p.y()) * ((double) r.x() - p.x());
+    }
+
+    /**
+     * Check if two segments cross each other properly, i.e. if their
+     * interiors intersect in a single point. Segments that only touch or
+     * overlap, such as the shared segments of neighboring boundaries, do
+     * not cross.
+     *
+     * @param p0 The first point of the first segment
+     * @param p1 The last point of the first segment
+     * @param q0 The first point of the second segment
+     * @param q1 The last point of the second segment
+     * @returns  True if the segments cross
+     *
+     * Time complexity: Constant
+     */
+    template <typename T>
+    inline bool segments_cross(const Point<T>& p0, const Point<T>& p1, const Point<T>& q0, const Point<T>& q1)
+    {
+        double d1 = orientation(q0, q1, p0);
+        double d2 = orientation(q0, q1, p1);
+        double d3 = orientation(p0, p1, q0);
+        double d4 = orientation(p0, p1, q1);
+        return ((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0))
+            && ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0));
+    }
+
     /**
      * Check if a point is inside of a ring using
-     * the ray-casting algorithm (also knowsn as even-odd
+     * the ray-casting algorithm (also known as even-odd
      * rule algorithm). For more information, refer to
      * https://en.wikipedia.org/wiki/Point_in_polygon and
      * https://www.codeproject.com/Tips/84226/Is-a-Point-inside-a-Polygon
      * 
      * @param point The point
      * @param ring  The ring
-     * @returns     True if the point is inside or on a segment of the ring
+     * @returns     1 if the point is inside of the ring, 0 if
+     *              it lies on a segment of the ring and -1 if
+     *              it is outside of the ring
      * 
      * Time complexity: Linear
      */
     template <typename T>
     inline int point_in_ring(const Point<T>& point, const Ring<T>& ring)
     {
-        int intersections;
-        for (std::size_t i = 0; i < ring.size() - 1; i++)
+        bool inside = false;
+        for (std::size_t i = 0; i + 1 < ring.size(); i++)
         {   
             const Point<T>& first = ring.at(i);
             const Point<T>& last = ring.at(i + 1);
-            // Check if point is in y-range of the ring segment (i, j)
-            if (first.y() > point.y() != last.y() > point.y())
+            // Check if the point lies on the ring segment (i, i + 1)
+            if (orientation(first, last, point) == 0 && point_in_segment(point, Segment<T>{ first, last }))
+            {
+                return 0;
+            }
+            // Check if point is in y-range of the ring segment (i, i + 1)
+            if ((first.y() > point.y()) != (last.y() > point.y()))
             {
                 // Check for intersections
                 if (point.x() < (last.x() - first.x()) * (point.y() - first.y()) / (last.y() - first.y()) + first.x())
                 {
-                    intersections++;
+                    inside = !inside;
                 }
             }
         }
-        // Check if the point lies on the ring. If that is the case, return 0.
-        if (intersections == 0)
+        // If the number of intersections is odd, the point is inside
+        return inside ? 1 : -1;
+    }
+
+    /**
+     * Check if a point is inside of a ring using the ray-casting
+     * algorithm. Only the segments in the grid cells along the ray
+     * are tested.
+     *
+     * @param point The point
+     * @param grid  The segment grid of the ring
+     * @returns     1 if the point is inside of the ring, 0 if
+     *              it lies on a segment of the ring and -1 if
+     *              it is outside of the ring
+     *
+     * Time complexity: Linear in the number of segments along the ray
+     */
+    template <typename T>
+    inline int point_in_ring(const Point<T>& point, const detail::SegmentGrid<T>& grid)
+    {
+        bool inside = false;
+        bool boundary = grid.any(point, Point<T>{ grid.bounds().max().x(), point.y() },
+            [&](const Point<T>& first, const Point<T>& last)
+            {
+                if (orientation(first, last, point) == 0 && point_in_segment(point, Segment<T>{ first, last }))
+                {
+                    return true;
+                }
+                if ((first.y() > point.y()) != (last.y() > point.y())
+                    && point.x() < (last.x() - first.x()) * (point.y() - first.y()) / (last.y() - first.y()) + first.x())
+                {
+                    inside = !inside;
+                }
+                return false;
+            }
+        );
+        if (boundary)
         {
             return 0;
         }
-        // If the number of intersections is odd, the return will be
-        // -1 (not inside), if it is even, the result will be
-        // 1 (inside)
-        return (intersections % 2 == 0 ? 1 : -1);
+        return inside ? 1 : -1;
     }
 
     /**
-     * Check if a ring is fully contained inside of another ring.
+     * Check if a ring is fully contained inside of another ring. The
+     * rings may touch and share segments, but must not cross.
+     *
+     * Neighboring boundaries share most of their nodes, so the nodes of
+     * the first ring that are also nodes of the second ring are not
+     * located, as they lie on the second ring anyway. All other nodes are
+     * located in the second ring. A segment between two shared nodes may
+     * still cut across a concave part of the second ring, so that its
+     * midpoint is located instead. Finally, the segments of the first
+     * ring are tested for crossings with the segments of the second ring
+     * in the same grid cells.
      * 
      * @param ring1 The first ring
      * @param ring2 The second ring
@@ -196,51 +293,40 @@ namespace functions
             return false;
         }
 
-        // Check if a point from ring 1 is contained inside of ring 2
-        for (const Point<T>& p : ring1)
+        // Determine the nodes of ring 1 that are also nodes of ring 2
+        std::vector<Point<T>> vertices{ ring2.begin(), ring2.end() };
+        std::sort(vertices.begin(), vertices.end(), detail::compare_lt<T>);
+        std::vector<bool> shared(ring1.size());
+        for (std::size_t i = 0; i < ring1.size(); i++)
         {
-            bool b = point_in_ring(p, ring2);
-            if (b < 0)
+            shared[i] = std::binary_search(vertices.begin(), vertices.end(), ring1[i], detail::compare_lt<T>);
+        }
+
+        // Check if the unshared nodes and the midpoints of the segments
+        // between shared nodes are contained inside of ring 2
+        detail::SegmentGrid<T> grid{ ring2 };
+        for (std::size_t i = 0; i + 1 < ring1.size(); i++)
+        {
+            if (!shared[i] && point_in_ring(ring1[i], grid) < 0)
             {
                 return false;
             }
-            else if (b == 0)
+            if (shared[i] && shared[i + 1] && point_in_ring((ring1[i] + ring1[i + 1]) * 0.5, grid) < 0)
             {
-                continue;
+                return false;
             }
+        }
 
-            for (std::size_t i = 0; i < ring1.size() - 1; i++)
+        // Check if any segment of ring 1 crosses ring 2
+        for (std::size_t i = 0; i + 1 < ring1.size(); i++)
+        {
+            const Point<T>& p0 = ring1[i];
+            const Point<T>& p1 = ring1[i + 1];
+            if (grid.any(p0, p1, [&](const Point<T>& q0, const Point<T>& q1) { return segments_cross(p0, p1, q0, q1); }))
             {
-                const geometry::Segment<T> s1{ ring1.at(i), ring1.at(i + 1) };
-                for (std::size_t j = i; j < ring2.size() - 1; j++)
-                {
-                    const geometry::Segment<T> s2{ ring2.at(j), ring2.at(j + 1) };
-                    if (segments_intersect(s1, s2))
-                    {
-                        return false;
-                    }
-
-                }
+                return false;
             }
-            return true;
-
-            //// Found a point of ring 1 that is contained within ring 2
-            //// Collect all segments of ring 1 and 2
-            //std::vector<Segment<T>> segments{};
-            //for (std::size_t i = 0; i < ring1.size() - 1; i++)
-            //{
-            //    segments.push_back(Segment<T>{ ring1.at(i), ring1.at(i + 1) });
-            //}
-            //for (std::size_t i = 0; i < ring2.size() - 1; i++)
-            //{
-            //    segments.push_back(Segment<T>{ ring2.at(i), ring2.at(i + 1) });
-            //}
-
-            //// Check for intersections
-            //return !functions::detail::shamos_hoey(segments);
         }
-
-        // Rings are the same
         return true;
     }
     
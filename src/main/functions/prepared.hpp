@@ -0,0 +1,416 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "model/geometry/point.hpp"
+#include "model/geometry/rectangle.hpp"
+#include "model/geometry/ring.hpp"
+#include "model/geometry/polygon.hpp"
+
+#include "functions/distance.hpp"
+#include "functions/envelope.hpp"
+#include "functions/intersect.hpp"
+#include "functions/detail/compare.hpp"
+
+using namespace model::geometry;
+
+namespace functions
+{
+
+    /**
+     * A polygon that is prepared for repeated point and containment
+     * queries, such as the queries of the hierarchy and the center
+     * calculation.
+     *
+     * The edges of all rings are bucketed into horizontal bands of equal
+     * height. A point query only has to test the edges of the band that
+     * contains the point instead of all edges of the polygon. With about
+     * sqrt(n) bands, a query tests about sqrt(n) edges on average.
+     *
+     * The points of the polygon are copied, so the polygon does not have
+     * to outlive the prepared polygon.
+     */
+    template <typename T>
+    class PreparedPolygon
+    {
+    protected:
+
+        /* Members */
+
+        Rectangle<T> m_bounds;
+
+        /**
+         * The points of all rings, which are stored consecutively.
+         */
+        std::vector<Point<T>> m_points;
+
+        /**
+         * The start indices of all edges in the point list.
+         */
+        std::vector<std::size_t> m_edges;
+
+        /**
+         * The points of all rings, sorted by their xy-order.
+         */
+        std::vector<Point<T>> m_vertices;
+
+        /**
+         * The bounding boxes of the inner rings.
+         */
+        std::vector<Rectangle<T>> m_inner_bounds;
+
+        std::size_t m_bands = 1;
+        double m_band_height = 0;
+
+        /**
+         * The edges of all bands, which are stored consecutively.
+         */
+        std::vector<std::size_t> m_band_edges;
+
+        /**
+         * The edge offsets of the bands, including the end offset.
+         */
+        std::vector<std::size_t> m_band_offsets;
+
+    public:
+
+        /* Constructors */
+
+        /**
+         * Prepares a polygon.
+         *
+         * @param polygon The polygon
+         *
+         * Time complexity: Log-Linear
+         */
+        PreparedPolygon(const Polygon<T>& polygon) : m_bounds(functions::envelope(polygon))
+        {
+            add(polygon.outer());
+            for (const Ring<T>& inner : polygon.inners())
+            {
+                add(inner);
+                m_inner_bounds.push_back(functions::envelope(inner));
+            }
+
+            m_vertices = m_points;
+            std::sort(m_vertices.begin(), m_vertices.end(), detail::compare_lt<T>);
+            m_vertices.erase(std::unique(m_vertices.begin(), m_vertices.end()), m_vertices.end());
+
+            // Count the edges of each band first, so that the edges can be
+            // stored without reallocations
+            if (m_bounds.height() > 0)
+            {
+                m_bands = std::max(std::size_t(1), (std::size_t) std::sqrt((double) m_edges.size()));
+                m_band_height = m_bounds.height() / m_bands;
+            }
+            m_band_offsets.assign(m_bands + 1, 0);
+            for (std::size_t edge : m_edges)
+            {
+                for (std::size_t b = first_band(edge); b <= last_band(edge); b++)
+                {
+                    m_band_offsets[b + 1]++;
+                }
+            }
+            for (std::size_t b = 0; b < m_bands; b++)
+            {
+                m_band_offsets[b + 1] += m_band_offsets[b];
+            }
+            m_band_edges.resize(m_band_offsets.back());
+            std::vector<std::size_t> positions{ m_band_offsets.begin(), m_band_offsets.end() - 1 };
+            for (std::size_t edge : m_edges)
+            {
+                for (std::size_t b = first_band(edge); b <= last_band(edge); b++)
+                {
+                    m_band_edges[positions[b]++] = edge;
+                }
+            }
+        }
+
+    protected:
+
+        /* Helper Methods */
+
+        void add(const Ring<T>& ring)
+        {
+            std::size_t offset = m_points.size();
+            m_points.insert(m_points.end(), ring.begin(), ring.end());
+            for (std::size_t i = offset; i + 1 < m_points.size(); i++)
+            {
+                m_edges.push_back(i);
+            }
+        }
+
+        const Point<T>& first(std::size_t edge) const
+        {
+            return m_points[edge];
+        }
+
+        const Point<T>& last(std::size_t edge) const
+        {
+            return m_points[edge + 1];
+        }
+
+        std::size_t band(T y) const
+        {
+            if (m_band_height <= 0 || y <= m_bounds.min().y())
+            {
+                return 0;
+            }
+            return std::min(m_bands - 1, (std::size_t) ((y - m_bounds.min().y()) / m_band_height));
+        }
+
+        std::size_t first_band(std::size_t edge) const
+        {
+            return band(std::min(first(edge).y(), last(edge).y()));
+        }
+
+        std::size_t last_band(std::size_t edge) const
+        {
+            return band(std::max(first(edge).y(), last(edge).y()));
+        }
+
+        /**
+         * Returns the vertical distance of a y-coordinate to a band.
+         */
+        double band_distance(T y, std::size_t b) const
+        {
+            double lower = m_bounds.min().y() + b * m_band_height;
+            double upper = lower + m_band_height;
+            return std::max(0.0, std::max(lower - y, y - upper));
+        }
+
+        /**
+         * Calls a predicate for each edge in the bands between two
+         * y-coordinates, which may visit an edge more than once. The
+         * search stops as soon as the predicate returns true.
+         */
+        template <typename Predicate>
+        bool any_edge(T y_min, T y_max, Predicate predicate) const
+        {
+            for (std::size_t b = band(y_min); b <= band(y_max); b++)
+            {
+                for (std::size_t i = m_band_offsets[b]; i < m_band_offsets[b + 1]; i++)
+                {
+                    if (predicate(m_band_edges[i]))
+                    {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+    public:
+
+        /* Accessors */
+
+        const Rectangle<T>& bounds() const
+        {
+            return m_bounds;
+        }
+
+        /**
+         * Returns the number of edges of all rings.
+         */
+        std::size_t size() const
+        {
+            return m_edges.size();
+        }
+
+        /* Methods */
+
+        /**
+         * Locates a point in the polygon using the ray-casting algorithm.
+         * Points in the inner rings are outside of the polygon.
+         *
+         * @param point The point
+         * @returns     1 if the point is inside of the polygon, 0 if it
+         *              lies on an edge of the polygon and -1 if it is
+         *              outside of the polygon
+         *
+         * Time complexity: Linear in the number of edges of the band
+         */
+        int locate(const Point<T>& point) const
+        {
+            if (!point_in_rectangle(point, m_bounds))
+            {
+                return -1;
+            }
+            bool inside = false;
+            std::size_t b = band(point.y());
+            for (std::size_t i = m_band_offsets[b]; i < m_band_offsets[b + 1]; i++)
+            {
+                const Point<T>& p = first(m_band_edges[i]);
+                const Point<T>& q = last(m_band_edges[i]);
+                if (orientation(p, q, point) == 0 && point_in_segment(point, Segment<T>{ p, q }))
+                {
+                    return 0;
+                }
+                if ((p.y() > point.y()) != (q.y() > point.y())
+                    && point.x() < (q.x() - p.x()) * (point.y() - p.y()) / (q.y() - p.y()) + p.x())
+                {
+                    inside = !inside;
+                }
+            }
+            return inside ? 1 : -1;
+        }
+
+        /**
+         * Calculates the signed distance of a point to the edges of the
+         * polygon. The bands are searched outwards from the band of the
+         * point until no closer edge is possible.
+         *
+         * @param point The point
+         * @returns     The signed distance, which is positive if the point
+         *              is inside of the polygon, negative if it is outside
+         *              and 0 if it lies on an edge
+         *
+         * Time complexity: Linear in the number of edges of the searched
+         *                  bands
+         */
+        double distance(const Point<T>& point) const
+        {
+            double result = std::numeric_limits<double>::max();
+            auto search = [&](std::size_t b)
+            {
+                for (std::size_t i = m_band_offsets[b]; i < m_band_offsets[b + 1]; i++)
+                {
+                    std::size_t edge = m_band_edges[i];
+                    result = std::min(result, segment_distance(point, first(edge), last(edge)));
+                }
+            };
+            std::size_t center = band(point.y());
+            search(center);
+            for (std::size_t offset = 1; offset < m_bands; offset++)
+            {
+                bool below = offset <= center && band_distance(point.y(), center - offset) < result;
+                bool above = center + offset < m_bands && band_distance(point.y(), center + offset) < result;
+                if (!below && !above)
+                {
+                    break;
+                }
+                if (below)
+                {
+                    search(center - offset);
+                }
+                if (above)
+                {
+                    search(center + offset);
+                }
+            }
+            if (m_edges.empty())
+            {
+                return 0;
+            }
+            return locate(point) < 0 ? -result : result;
+        }
+
+        /**
+         * Check if a ring is fully contained inside of the polygon. The
+         * ring may touch the edges of the polygon, but must not cross them.
+         *
+         * The nodes of the ring that are also nodes of the polygon are not
+         * located, as they lie on the polygon anyway. All other nodes and
+         * the midpoints of the segments between two shared nodes, which
+         * may cut across a concave part of the polygon, are located before
+         * the edges of the ring are tested for crossings. A ring that lies
+         * on the edges of the polygon only is contained, unless it is one
+         * of the inner rings.
+         *
+         * @param ring The ring
+         * @returns    True if the ring is inside of the polygon
+         *
+         * Time complexity: Linear in the number of ring nodes and the
+         *                  edges of their bands
+         */
+        bool contains(const Ring<T>& ring) const
+        {
+            // Compare bounding boxes first
+            Rectangle<T> bounds = functions::envelope(ring);
+            if (!rectangle_in_rectangle(bounds, m_bounds))
+            {
+                return false;
+            }
+
+            // Determine the nodes of the ring that are also nodes of the
+            // polygon
+            std::vector<bool> shared(ring.size());
+            for (std::size_t i = 0; i < ring.size(); i++)
+            {
+                shared[i] = std::binary_search(m_vertices.begin(), m_vertices.end(), ring[i], detail::compare_lt<T>);
+            }
+
+            // Check if the unshared nodes and the midpoints of the segments
+            // between shared nodes are contained inside of the polygon
+            bool inside = false;
+            for (std::size_t i = 0; i + 1 < ring.size(); i++)
+            {
+                int location = 0;
+                if (!shared[i])
+                {
+                    location = locate(ring[i]);
+                }
+                else if (shared[i + 1])
+                {
+                    location = locate((ring[i] + ring[i + 1]) * 0.5);
+                }
+                if (location < 0)
+                {
+                    return false;
+                }
+                inside = inside || location > 0;
+            }
+            if (!inside)
+            {
+                // The ring lies on the edges of the polygon, which is only
+                // contained if it is not an inner ring
+                return std::none_of(m_inner_bounds.begin(), m_inner_bounds.end(), [&](const Rectangle<T>& inner)
+                {
+                    return rectangle_in_rectangle(bounds, inner) && rectangle_in_rectangle(inner, bounds);
+                });
+            }
+
+            // Check if any segment of the ring crosses an edge
+            for (std::size_t i = 0; i + 1 < ring.size(); i++)
+            {
+                const Point<T>& p0 = ring[i];
+                const Point<T>& p1 = ring[i + 1];
+                T min_x = std::min(p0.x(), p1.x());
+                T max_x = std::max(p0.x(), p1.x());
+                bool crossed = any_edge(std::min(p0.y(), p1.y()), std::max(p0.y(), p1.y()), [&](std::size_t edge)
+                {
+                    const Point<T>& q0 = first(edge);
+                    const Point<T>& q1 = last(edge);
+                    if (std::max(q0.x(), q1.x()) < min_x || std::min(q0.x(), q1.x()) > max_x)
+                    {
+                        return false;
+                    }
+                    return segments_cross(p0, p1, q0, q1);
+                });
+                if (crossed)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * Check if a polygon is fully contained inside of this polygon.
+         * A polygon that lies inside of an inner ring is not contained.
+         *
+         * @param polygon The polygon
+         * @returns       True if the polygon is inside of this polygon
+         */
+        bool contains(const Polygon<T>& polygon) const
+        {
+            return contains(polygon.outer());
+        }
+
+    };
+
+}
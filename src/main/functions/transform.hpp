@@ -1,7 +1,11 @@
 #pragma once
 
+#include <cstddef>
+#include <tuple>
 #include <utility>
 
+#include "model/geometry/point.hpp"
+
 #include "functions/util.hpp"
 
 namespace functions
@@ -248,7 +252,7 @@ namespace functions
         SymmetricTransformation(Interval<T> source_x, Interval<T> source_y)
         : IntervalTransformation<T>(source_x, source_y, Interval<T>(-1, 1), Interval<T>(-1, 1)) {}
 
-        using IntervalTransformation<T>::project;
+        using IntervalTransformation<T>::transform;
 
     };
 
@@ -369,4 +373,90 @@ namespace functions
 
     };
 
+    /* Compositions */
+
+    /**
+     * A transformation that applies a sequence of transformations in the
+     * specified order.
+     *
+     * The transformations are stored with their concrete types and called
+     * without virtual dispatch, so that they are inlined into a single
+     * kernel instead of one virtual call per transformation and point.
+     * Ranges of points should be transformed at once, so that the kernel
+     * runs over contiguous coordinates and can be vectorized.
+     */
+    template <typename T, typename... Transformations>
+    class ComposedTransformation : public Transformation<T>
+    {
+    protected:
+
+        /* Members */
+
+        std::tuple<Transformations...> m_transformations;
+
+    public:
+
+        /* Constructors */
+
+        ComposedTransformation(Transformations... transformations)
+        : m_transformations(std::move(transformations)...) {}
+
+    protected:
+
+        /* Helper Methods */
+
+        inline void apply(T& x, T& y) const
+        {
+            std::apply([&](const Transformations&... transformations)
+            {
+                (transformations.Transformations::transform(x, y), ...);
+            }, m_transformations);
+        }
+
+    public:
+
+        /* Methods */
+
+        /**
+         * Transform a pair of values with all transformations.
+         *
+         * @param x The x value
+         * @param y The y value
+         */
+        void transform(T& x, T& y) const override
+        {
+            apply(x, y);
+        }
+
+        /**
+         * Transform a contiguous range of points with all transformations.
+         *
+         * @param first The first point of the range
+         * @param last  The end of the range
+         *
+         * Time complexity: Linear
+         */
+        void transform(model::geometry::Point<T>* first, model::geometry::Point<T>* last) const
+        {
+            for (; first != last; ++first)
+            {
+                apply(first->x(), first->y());
+            }
+        }
+
+    };
+
+    /**
+     * Composes a sequence of transformations, which are applied in the
+     * specified order.
+     *
+     * @param transformations The transformations
+     * @returns               The composed transformation
+     */
+    template <typename T, typename... Transformations>
+    inline ComposedTransformation<T, Transformations...> compose(Transformations... transformations)
+    {
+        return ComposedTransformation<T, Transformations...>{ std::move(transformations)... };
+    }
+
 }
\ No newline at end of file
@@ -1,35 +1,83 @@
+#pragma once
+
+#include <algorithm>
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include <osmium/builder/osm_object_builder.hpp>
+#include <osmium/handler.hpp>
 #include <osmium/index/id_set.hpp>
+#include <osmium/index/map/flex_mem.hpp>
+#include <osmium/memory/buffer.hpp>
 #include <osmium/index/nwr_array.hpp>
-#include <osmium/index/relations_map.hpp>
+#include <osmium/osm/node.hpp>
+#include <osmium/osm/relation.hpp>
 #include <osmium/osm/way.hpp>
 #include <osmium/tags/tags_filter.hpp>
-#include <osmium/relations/relations_manager.hpp>
 
 #include "model/types.hpp"
+#include "util/osm.hpp"
+#include "util/parallel.hpp"
 
 namespace handler
 {
 
     /**
-     * This class collects all data needed for creating areas from
+     * This handler collects all data needed for creating areas from
      * relations tagged with type=multipolygon or type=boundary.
-     * Most of its functionality is derived from the parent template class
-     * osmium::relations::RelationsManager.
-     * 
+     *
+     * The objects are passed to the manager by type, all relations before
+     * the ways and all ways before the nodes:
+     *
+     * 1. The relations are filtered and copied to the relation buffer,
+     *    while their way members are marked.
+     * 2. The member ways and closed boundary ways are copied to the way
+     *    buffer, which is the only copy of the ways. Afterwards, the
+     *    complete relations are determined and the nodes of their ways
+     *    are marked.
+     * 3. Only the locations of the marked nodes are stored, so that the
+     *    memory usage is proportional to the nodes of the boundaries
+     *    instead of the nodes of the input.
+     *
+     * The nodes are written from the stored locations afterwards, so that
+     * the input does not have to be read once more to copy the objects.
+     *
+     * The objects can either be passed one at a time by the osmium callbacks
+     * or block by block, such as the decoded blocks of a file that is read
+     * in reverse order. The blocks are filtered by const methods, which can
+     * run on several threads at once, and the results are added in block
+     * order afterwards. A block may contain objects of several types, which
+     * are then passed in the same order.
+     *
      * This implementation is oriented at existing implementations in the
      * osmium-tool, especially for the tags-filter command:
      * https://github.com/osmcode/osmium-tool/blob/master/src/command_tags_filter.cpp
      */
-    class BoundaryManager : public osmium::relations::RelationsManager<BoundaryManager, false, true, false>
+    class BoundaryManager : public osmium::handler::Handler
     {
+    public:
+
+        /* Types */
+
+        /**
+         * The type of the node locations collected from a block.
+         */
+        using location_list = std::vector<std::pair<osmium::unsigned_object_id_type, osmium::Location>>;
+
     protected:
 
         /* Types */
 
-        using nwr_array = osmium::nwr_array<osmium::index::IdSetDense<osmium::unsigned_object_id_type>>;
+        using id_set_type = osmium::index::IdSetDense<osmium::unsigned_object_id_type>;
+
+        using nwr_array = osmium::nwr_array<id_set_type>;
+
+        /**
+         * The type of index used for the node locations.
+         */
+        using index_type = osmium::index::map::FlexMem<osmium::unsigned_object_id_type, osmium::Location>;
 
         /* Members */   
 
@@ -43,18 +91,127 @@ namespace handler
         */
         nwr_array m_matching_ids;
 
+        /**
+         * The ids of the ways that are members of a filtered relation.
+         */
+        id_set_type m_member_ids;
+
+        /**
+         * The ids of the ways that were copied to the way buffer.
+         */
+        id_set_type m_found_ids;
+
+        /**
+         * The locations of the marked nodes.
+         */
+        index_type m_locations;
+
+        /**
+         * Whether the location index was sorted for lookups.
+         */
+        bool m_sorted = false;
+
+        /**
+         * Whether the complete relations were determined.
+         */
+        bool m_completed = false;
+
+        /**
+         * The number of marked nodes that were found in the input.
+         */
+        std::size_t m_located = 0;
+
+        /**
+         * The number of marked nodes that were not found in the input,
+         * which is determined while the nodes are written.
+         */
+        std::size_t m_missing = 0;
+
+        /**
+         * The number of filtered relations with missing way members.
+         */
+        std::size_t m_incomplete = 0;
+
+        /**
+         * The number of bytes of the ways and relations that will be
+         * written.
+         */
+        std::size_t m_output_size = 0;
+
+        /**
+         * The buffer for the member ways and closed boundary ways.
+         */
+        osmium::memory::Buffer m_ways{ 1024, osmium::memory::Buffer::auto_grow::yes };
+
+        /**
+         * The buffer for the filtered relations.
+         */
+        osmium::memory::Buffer m_relations{ 1024, osmium::memory::Buffer::auto_grow::yes };
+
         /* Methods */
 
         /**
-         * 
+         * Copies a relation to a buffer and sets the references to members
+         * of other types than ways to 0.
+         *
+         * @param buffer   The buffer
+         * @param relation The relation
+         * @returns        The copy of the relation
+         */
+        static const osmium::Relation& copy_relation(osmium::memory::Buffer& buffer, const osmium::Relation& relation)
+        {
+            std::size_t offset = buffer.committed();
+            buffer.add_item(relation);
+            buffer.commit();
+            osmium::Relation& copy = buffer.get<osmium::Relation>(offset);
+            for (osmium::RelationMember& member : copy.members())
+            {
+                if (member.type() != osmium::item_type::way)
+                {
+                    member.set_ref(0);
+                }
+            }
+            return copy;
+        }
+
+        /**
+         * Marks the way members of a filtered relation.
+         */
+        void mark_members(const osmium::Relation& relation)
+        {
+            for (const osmium::RelationMember& member : relation.members())
+            {
+                if (member.ref() != 0)
+                {
+                    m_member_ids.set(member.positive_ref());
+                }
+            }
+        }
+
+        /**
+         * Marks a copied way as found and closed boundary ways for insertion.
          */
-        bool is_polygon(const osmium::Way& way) const
+        void mark_way(const osmium::Way& way)
         {
-            return way.nodes().size() > 3
-                && !way.tags().has_tag("area", "no")
-                && way.nodes().front().location()
-                && way.nodes().back().location()
-                && way.ends_have_same_location();
+            // Check if the way describes a valid polygon with an admin_level
+            // that is contained in the specified filter
+            if (util::is_area_way(way, m_filter))
+            {
+                m_matching_ids(osmium::item_type::way).set(way.positive_id());
+            }
+            m_found_ids.set(way.positive_id());
+        }
+
+        /**
+         * Sorts the location index, which is needed before any lookups.
+         */
+        void sort_locations()
+        {
+            if (!m_sorted)
+            {
+                m_locations.sort();
+                m_sorted = true;
+            }
         }
 
     public:
@@ -76,91 +233,418 @@ namespace handler
             return m_matching_ids;
         }
 
-        /* Osmium Methods */
+        /**
+         * Returns the number of filtered relations that were skipped, as
+         * some of their way members were not part of the input.
+         */
+        std::size_t incomplete_relations() const
+        {
+            return m_incomplete;
+        }
 
         /**
-         * We are interested in all relations tagged with type=multipolygon
-         * or type=boundary with at least one way member (and an admin_level
-         * contained in the TagFilter if specified)
+         * Returns the number of marked nodes that were not part of the
+         * input. These nodes are not written and the node references to
+         * them keep an undefined location. The number is only available
+         * after the nodes were written.
          */
-        bool new_relation(const osmium::Relation& relation) const
+        std::size_t missing_nodes() const
         {
-            const char* type = relation.tags().get_value_by_key("type");
+            return m_missing;
+        }
+
+        /* Methods */
 
-            // Ignore relations without "type" tag
-            if (type == nullptr)
+        /**
+         * Retrieves the number of bytes that a node written by this manager
+         * takes up in a buffer. As the nodes only consist of their id and
+         * location, the size is the same for all of them.
+         */
+        static std::size_t node_size()
+        {
+            osmium::memory::Buffer buffer{ 1024 };
             {
-                return false;
+                osmium::builder::NodeBuilder builder{ buffer };
             }
+            buffer.commit();
+            return buffer.committed();
+        }
+
+        /**
+         * Retrieves the number of bytes that the nodes, ways and relations
+         * collected by this manager take up in a buffer. This can be used to
+         * allocate the output buffer once. The size is exact unless the input
+         * contains a node more than once.
+         */
+        std::size_t output_size() const
+        {
+            return m_located * node_size() + m_output_size;
+        }
 
-            // Check if the relation is an administrative boundary with at least
-            // one way.
-            if (((!std::strcmp(type, "multipolygon")) || (!std::strcmp(type, "boundary"))) && osmium::tags::match_any_of(relation.tags(), m_filter)) {
-                return std::any_of(relation.members().cbegin(), relation.members().cend(), [](const osmium::RelationMember& member) {
-                    return member.type() == osmium::item_type::way;
+        /**
+         * Determines the complete relations after the ways were read, which
+         * are the relations whose way members were all found in the input.
+         * The relations, their ways and the closed boundary ways are marked
+         * for insertion, and so are the nodes of the marked ways.
+         *
+         * The relations are only determined once, so further calls have no
+         * effect.
+         */
+        void complete_relations()
+        {
+            if (m_completed)
+            {
+                return;
+            }
+            m_completed = true;
+            for (const osmium::Relation& relation : m_relations.select<osmium::Relation>())
+            {
+                bool complete = std::all_of(relation.members().cbegin(), relation.members().cend(), [&](const osmium::RelationMember& member) {
+                    return member.ref() == 0 || m_found_ids.get(member.positive_ref());
                 });
+                if (!complete)
+                {
+                    m_incomplete++;
+                    continue;
+                }
+                m_matching_ids(osmium::item_type::relation).set(relation.positive_id());
+                m_output_size += relation.byte_size();
+                for (const osmium::RelationMember& member : relation.members())
+                {
+                    if (member.ref() != 0)
+                    {
+                        m_matching_ids(osmium::item_type::way).set(member.positive_ref());
+                    }
+                }
             }
+            // Mark the referenced nodes of the marked ways for insertion
+            for (const osmium::Way& way : m_ways.select<osmium::Way>())
+            {
+                if (!m_matching_ids(osmium::item_type::way).get(way.positive_id()))
+                {
+                    continue;
+                }
+                m_output_size += way.byte_size();
+                for (const osmium::NodeRef& nr : way.nodes())
+                {
+                    if (nr.ref() != 0)
+                    {
+                        m_matching_ids(osmium::item_type::node).set(nr.positive_ref());
+                    }
+                }
+            }
+        }
+
+        /**
+         * Writes a node for each marked node that was found in the input to
+         * a buffer. The nodes are created from the stored locations and are
+         * written in ascending id order.
+         *
+         * The marked ids are split into consecutive blocks, which are written
+         * to one buffer per block on the worker threads. The block buffers are
+         * appended to the output buffer in block order afterwards, so the
+         * result does not depend on the number of threads.
+         *
+         * The marked nodes that are not part of the input are counted, which
+         * is more reliable than comparing the number of marked and located
+         * nodes, as the input may contain a node more than once.
+         *
+         * @param buffer  The output buffer
+         * @param threads The number of worker threads (0 = auto)
+         */
+        void write_nodes(osmium::memory::Buffer& buffer, std::size_t threads = 1)
+        {
+            // The location index has to be sorted before any lookups
+            sort_locations();
 
-            return false;
+            // Collect the marked node ids in ascending order
+            const auto& node_ids = m_matching_ids(osmium::item_type::node);
+            std::vector<osmium::unsigned_object_id_type> ids;
+            ids.reserve(node_ids.size());
+            for (const osmium::unsigned_object_id_type id : node_ids)
+            {
+                ids.push_back(id);
+            }
+            if (ids.empty())
+            {
+                return;
+            }
+
+            // Split the ids into blocks. Using more blocks than threads
+            // balances the work if some threads are slower than others.
+            // The block buffers are allocated with their final size.
+            std::size_t block_count = std::min(ids.size(), 4 * util::thread_count(threads));
+            std::size_t block_size = (ids.size() + block_count - 1) / block_count;
+            std::size_t size = node_size();
+            std::vector<osmium::memory::Buffer> blocks;
+            std::vector<std::size_t> missing(block_count, 0);
+            blocks.reserve(block_count);
+            for (std::size_t b = 0; b < block_count; b++)
+            {
+                std::size_t first = std::min(ids.size(), b * block_size);
+                std::size_t last = std::min(ids.size(), first + block_size);
+                blocks.emplace_back(
+                    std::max((last - first) * size, std::size_t(1024)),
+                    osmium::memory::Buffer::auto_grow::yes
+                );
+            }
+
+            // Create the nodes of each block, skipping the nodes that were
+            // not part of the input
+            util::parallel_for(block_count, threads, [&](std::size_t b)
+            {
+                osmium::memory::Buffer& block = blocks.at(b);
+                std::size_t last = std::min(ids.size(), (b + 1) * block_size);
+                for (std::size_t i = b * block_size; i < last; i++)
+                {
+                    osmium::Location location = m_locations.get_noexcept(ids[i]);
+                    if (!location)
+                    {
+                        missing[b]++;
+                        continue;
+                    }
+                    {
+                        osmium::builder::NodeBuilder builder{ block };
+                        builder.set_id(ids[i]);
+                        builder.set_location(location);
+                    }
+                    block.commit();
+                }
+            });
+
+            // Concatenate the blocks in order
+            for (std::size_t b = 0; b < block_count; b++)
+            {
+                buffer.add_buffer(blocks[b]);
+                buffer.commit();
+                m_missing += missing[b];
+            }
         }
 
         /**
-         * This is called when a relation is complete, ie. all members
-         * were found in the input.
-         * 
-         * Note: This method only is called for relations that match the
-         * specified filter conditions
+         * Writes the marked ways to a buffer. The node references of the
+         * ways are located with the stored node locations, so that later
+         * stages do not need to build a location index of their own. The
+         * references to nodes that were not part of the input are skipped
+         * and keep an undefined location.
+         *
+         * The ways are located in blocks on the worker threads, as the
+         * sorted location index can be read concurrently. Afterwards, they
+         * are copied to the output buffer in their original order.
+         *
+         * @param buffer  The output buffer
+         * @param threads The number of worker threads (0 = auto)
          */
-        void complete_relation(const osmium::Relation& relation)
+        void write_ways(osmium::memory::Buffer& buffer, std::size_t threads = 1)
         {
-            // Mark the relation for insertion
-            m_matching_ids(osmium::item_type::relation).set(relation.id());
-            const char* admin_level = relation.get_value_by_key(admin_level);
-            // Add the way members and their nodes to the output buffer
-            for (const auto& member : relation.members())
+            sort_locations();
+            std::vector<osmium::Way*> ways;
+            for (osmium::Way& way : m_ways.select<osmium::Way>())
             {
-                if (member.ref() != 0)
+                if (m_matching_ids(osmium::item_type::way).get(way.positive_id()))
+                {
+                    ways.push_back(&way);
+                }
+            }
+            std::size_t block_count = std::min(ways.size(), 4 * util::thread_count(threads));
+            util::parallel_for(block_count, threads, [&](std::size_t b)
+            {
+                for (std::size_t i = b * ways.size() / block_count; i < (b + 1) * ways.size() / block_count; i++)
                 {
-                    // We should handle ways only at this point
-                    assert(member.type() == osmium::item_type::way);
-                    // Mark the way for insertion
-                    const osmium::Way* way = this->get_member_way(member.ref());
-                    m_matching_ids(osmium::item_type::way).set(way->id());
-                    // Mark the referenced nodes for insertion
-                    for (const osmium::NodeRef& nr : way->nodes())
+                    for (osmium::NodeRef& nr : ways[i]->nodes())
                     {
-                        if (nr.ref() != 0)
+                        osmium::Location location = m_locations.get_noexcept(nr.positive_ref());
+                        if (location)
                         {
-                            m_matching_ids(osmium::item_type::node).set(nr.positive_ref());
+                            nr.set_location(location);
                         }
                     }
                 }
+            });
+            for (const osmium::Way* way : ways)
+            {
+                buffer.add_item(*way);
+                buffer.commit();
             }
         }
 
-        void after_way(const osmium::Way& way)
+        /**
+         * Writes the complete relations to a buffer.
+         *
+         * @param buffer The output buffer
+         */
+        void write_relations(osmium::memory::Buffer& buffer) const
         {
-            // Check if the way describes a valid polygon
-            if (!is_polygon(way))
+            for (const osmium::Relation& relation : m_relations.select<osmium::Relation>())
             {
-                return;
+                if (m_matching_ids(osmium::item_type::relation).get(relation.positive_id()))
+                {
+                    buffer.add_item(relation);
+                    buffer.commit();
+                }
             }
-            // Check that the admin_level of the way is contained in the
-            // specified filter
-            if (!osmium::tags::match_any_of(way.tags(), m_filter))
+        }
+
+        /* Block Methods */
+
+        /**
+         * Copies the filtered relations of a block to a new buffer. The
+         * references to members of other types than ways are set to 0, as
+         * only the ways are needed to assemble the areas.
+         *
+         * This method does not change the manager, so it can be called for
+         * different blocks on multiple threads at once. The result is passed
+         * to add_relations() afterwards.
+         *
+         * @param block The buffer with the objects of a block
+         * @returns     The buffer with the filtered relations
+         */
+        osmium::memory::Buffer filter_relations(const osmium::memory::Buffer& block) const
+        {
+            osmium::memory::Buffer relations{ 1024, osmium::memory::Buffer::auto_grow::yes };
+            for (const osmium::Relation& relation : block.select<osmium::Relation>())
             {
-                return;
+                if (util::is_boundary(relation, m_filter))
+                {
+                    copy_relation(relations, relation);
+                }
             }
-            // Mark the way for insertion
-            m_matching_ids(osmium::item_type::way).set(way.id());
-            // Mark the referenced nodes for insertion
-            for (const osmium::NodeRef& nr : way.nodes())
+            return relations;
+        }
+
+        /**
+         * Adds the filtered relations of a block and marks their way members.
+         *
+         * @param relations The buffer returned by filter_relations()
+         */
+        void add_relations(const osmium::memory::Buffer& relations)
+        {
+            for (const osmium::Relation& relation : relations.select<osmium::Relation>())
             {
-                if (nr.ref() != 0)
+                mark_members(relation);
+            }
+            m_relations.add_buffer(relations);
+            m_relations.commit();
+        }
+
+        /**
+         * Copies the member ways of the added relations and the closed ways
+         * that describe boundaries on their own of a block to a new buffer.
+         * All relations have to be added before.
+         *
+         * This method does not change the manager, so it can be called for
+         * different blocks on multiple threads at once. The result is passed
+         * to add_ways() afterwards.
+         *
+         * @param block The buffer with the objects of a block
+         * @returns     The buffer with the filtered ways
+         */
+        osmium::memory::Buffer filter_ways(const osmium::memory::Buffer& block) const
+        {
+            osmium::memory::Buffer ways{ 1024, osmium::memory::Buffer::auto_grow::yes };
+            for (const osmium::Way& way : block.select<osmium::Way>())
+            {
+                if (m_member_ids.get(way.positive_id()) || util::is_area_way(way, m_filter))
                 {
-                    m_matching_ids(osmium::item_type::node).set(nr.positive_ref());
+                    ways.add_item(way);
+                    ways.commit();
                 }
             }
+            return ways;
+        }
+
+        /**
+         * Adds the filtered ways of a block.
+         *
+         * @param ways The buffer returned by filter_ways()
+         */
+        void add_ways(const osmium::memory::Buffer& ways)
+        {
+            for (const osmium::Way& way : ways.select<osmium::Way>())
+            {
+                mark_way(way);
+            }
+            m_ways.add_buffer(ways);
+            m_ways.commit();
+        }
+
+        /**
+         * Collects the locations of the marked nodes of a block. The complete
+         * relations have to be determined before.
+         *
+         * This method does not change the manager, so it can be called for
+         * different blocks on multiple threads at once. The result is passed
+         * to add_nodes() afterwards.
+         *
+         * @param block The buffer with the objects of a block
+         * @returns     The ids and locations of the marked nodes
+         */
+        location_list filter_nodes(const osmium::memory::Buffer& block) const
+        {
+            location_list locations;
+            for (const osmium::Node& node : block.select<osmium::Node>())
+            {
+                if (m_matching_ids(osmium::item_type::node).get(node.positive_id()))
+                {
+                    locations.emplace_back(node.positive_id(), node.location());
+                }
+            }
+            return locations;
+        }
+
+        /**
+         * Stores the locations of the marked nodes of a block.
+         *
+         * @param locations The list returned by filter_nodes()
+         */
+        void add_nodes(const location_list& locations)
+        {
+            for (const auto& [id, location] : locations)
+            {
+                m_locations.set(id, location);
+            }
+            m_located += locations.size();
+        }
+
+        /* Osmium Methods */
+
+        /**
+         * Copies the filtered relations and marks their way members. The
+         * references to members of other types are set to 0, as only the
+         * ways are needed to assemble the areas.
+         */
+        void relation(const osmium::Relation& relation)
+        {
+            if (util::is_boundary(relation, m_filter))
+            {
+                mark_members(copy_relation(m_relations, relation));
+            }
+        }
+
+        /**
+         * Copies the member ways of the filtered relations and the closed
+         * ways that describe boundaries on their own.
+         */
+        void way(const osmium::Way& way)
+        {
+            if (m_member_ids.get(way.positive_id()) || util::is_area_way(way, m_filter))
+            {
+                mark_way(way);
+                m_ways.add_item(way);
+                m_ways.commit();
+            }
+        }
+
+        /**
+         * Stores the location of a marked node.
+         */
+        void node(const osmium::Node& node)
+        {
+            if (m_matching_ids(osmium::item_type::node).get(node.positive_id()))
+            {
+                m_locations.set(node.positive_id(), node.location());
+                m_located++;
+            }
         }
 
     };
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <osmium/handler.hpp>
+#include <osmium/osm/area.hpp>
 #include <osmium/osm/box.hpp>
 #include <osmium/osm/node.hpp>
 
@@ -27,6 +28,19 @@ namespace handler
             return m_bounds;
         };
 
+        /* Methods */
+
+        /**
+         * Extends the bounds by the bounds of another handler, such as a
+         * handler that was applied to another block of the same input.
+         *
+         * @param other The other handler
+         */
+        void merge(const BoundsHandler& other)
+        {
+            m_bounds.extend(other.m_bounds);
+        }
+
         /* Osmium functions */
 
         void node(const osmium::Node& node) noexcept
@@ -34,6 +48,16 @@ namespace handler
             m_bounds.extend(node.location());
         }
 
+        void area(const osmium::Area& area) noexcept
+        {
+            // The inner rings lie within the outer rings, so the outer rings
+            // are sufficient
+            for (const osmium::OuterRing& outer : area.outer_rings())
+            {
+                m_bounds.extend(outer.envelope());
+            }
+        }
+
     };
 
 }
\ No newline at end of file
@@ -1,9 +1,9 @@
 #pragma once
 
-#include <set>
+#include <stack>
+#include <utility>
 
-#include <osmium/handler.hpp>
-#include <osmium/osm/way.hpp>
+#include <osmium/index/id_set.hpp>
 #include <osmium/osm/node_ref.hpp>
 #include <osmium/osm/node_ref_list.hpp>
 
@@ -14,49 +14,86 @@ namespace handler
 {
 
     /**
-     * A handler that counts the total number of nodes, ways and
-     * relations of an osmium object stream.
-     *
-     * Port of https://github.com/osmcode/libosmium/blob/master/examples/osmium_count.cpp
+     * A handler that compresses the arcs of a topology with the
+     * Douglas-Peucker algorithm and collects the ids of the nodes that
+     * can be removed. The junctions of the topology are never removed.
      */
-    class CompressionHandler : public osmium::handler::Handler
+    class CompressionHandler
     {
+    public:
+
+        /* Types */
+
+        /**
+         * The node id set type. Node ids are dense, so a bitset is both
+         * smaller and faster than a tree set.
+         */
+        using id_set_type = osmium::index::IdSetDense<osmium::unsigned_object_id_type>;
+
     protected:
 
         /* Members */
 
         /**
-         *
+         * The compression distance tolerance (epsilon).
          */
         double m_tolerance;
 
         /**
-         *
+         * The ids of nodes that must not be removed, as they are shared by
+         * more than two way segments.
          */
-        std::set<osmium::object_id_type> m_ignored_nodes;
+        const id_set_type& m_ignored_nodes;
 
         /**
-         *  The compression result array of node indices that indicates
-         *  which nodes should be kept or removed.
+         *  The compression result set of node ids that indicates
+         *  which nodes should be removed.
          */
-        std::set<osmium::object_id_type> m_removed_nodes;
+        id_set_type m_removed_nodes;
 
     public:
 
         /* Constructors */
 
-        CompressionHandler(double tolerance) : m_tolerance(tolerance) {}
-
-        CompressionHandler(double tolerance, const std::set<osmium::object_id_type>& ignored_nodes)
+        CompressionHandler(double tolerance, const id_set_type& ignored_nodes)
             : m_tolerance(tolerance), m_ignored_nodes(ignored_nodes) {}
 
         /* Accessors */
 
-        const std::set<osmium::object_id_type>& removed_nodes() const
+        const id_set_type& removed_nodes() const
         {
             return m_removed_nodes;
         };
 
+        /* Methods */
+
+        /**
+         * Compresses a polyline, such as an arc of a topology.
+         *
+         * @param nodes The node references of the polyline
+         */
+        template <typename NodeContainer>
+        void compress(const NodeContainer& nodes)
+        {
+            douglas_peucker(nodes, m_tolerance);
+        }
+
+        /**
+         * Adds the removed nodes of another handler, which compressed a
+         * different set of arcs. As the inner nodes of the arcs are
+         * disjoint, the merged result is the same as if one handler had
+         * compressed all arcs.
+         *
+         * @param other The other handler
+         */
+        void merge(const CompressionHandler& other)
+        {
+            for (const osmium::unsigned_object_id_type id : other.m_removed_nodes)
+            {
+                m_removed_nodes.set(id);
+            }
+        }
+
     protected:
 
         /* Helper Methods */
@@ -75,8 +112,14 @@ namespace handler
         *
         * Time complexity: Log-Linear (Average-case), Quadratic (Worst-case)
         */
-        inline void douglas_peucker(const osmium::NodeRefList& nodes, double tolerance)
+        template <typename NodeContainer>
+        inline void douglas_peucker(const NodeContainer& nodes, double tolerance)
         {
+            if (nodes.size() < 3)
+            {
+                return;
+            }
+
             // Create the index stack for the iterative version
             // of the algorithm
             std::stack<std::pair<std::size_t, std::size_t>> stack;
@@ -96,7 +139,7 @@ namespace handler
                 {
                     // Check if node was removed already in another
                     // iteration
-                    if (!m_removed_nodes.count(nodes[i].ref()))
+                    if (!m_removed_nodes.get(nodes[i].positive_ref()))
                     {
                         double d = functions::perpendicular_distance(
                             model::geometry::Point{ nodes[i].lon(), nodes[i].lat() },
@@ -124,25 +167,16 @@ namespace handler
                     // start and end node, except nodes with degree > 2
                     for (std::size_t i = start + 1; i < end; i++)
                     {
-                        osmium::object_id_type n_id = nodes[i].ref();
-                        if (!m_ignored_nodes.count(n_id))
+                        osmium::unsigned_object_id_type n_id = nodes[i].positive_ref();
+                        if (!m_ignored_nodes.get(n_id))
                         {
-                            m_removed_nodes.insert(n_id);
+                            m_removed_nodes.set(n_id);
                         }
                     }
                 }
             }
         }
 
-    public:
-
-        /* Osmium Methods */
-
-        void way(const osmium::Way& way) noexcept
-        {
-            douglas_peucker(way.nodes(), m_tolerance);
-        }
-
     };
 
 }
\ No newline at end of file
@@ -11,6 +11,7 @@
 
 #include "functions/envelope.hpp"
 #include "functions/transform.hpp"
+#include "model/boundary.hpp"
 #include "model/types.hpp"
 
 using namespace model;
@@ -18,45 +19,38 @@ using namespace model;
 namespace handler
 {
 
-    template <typename T>
+    /**
+     * A handler that converts the areas of a buffer to boundaries with
+     * multipolygon geometries.
+     *
+     * The transformation has to provide a method that transforms a range of
+     * points at once, such as a functions::ComposedTransformation. Its type
+     * is known at compile time, so that the transformation kernel can be
+     * inlined into the conversion of each ring.
+     */
+    template <typename T, typename Transformation>
     class BoundaryConvertHandler : public osmium::handler::Handler
     {
     protected:
 
-        /* Types */
-
-        using Transformation = std::shared_ptr<functions::Transformation<T>>;;
-
         /* Members */
 
         /**
-         *
+         * The transformation that is applied on the node locations.
          */
-        std::vector<Transformation> m_transformations;
-
-       /**
-        *
-        */
-        std::map<object_id_type, Boundary<T>> m_boundaries;
+        Transformation m_transformation;
 
     public:
 
         /* Constructors */
 
-        BoundaryConvertHandler() {}
-        BoundaryConvertHandler(Transformation transformation) : m_transformations({ transformation }) {}
-        BoundaryConvertHandler(const std::vector<Transformation>& transformations) : m_transformations(transformations) {}
+        BoundaryConvertHandler(const Transformation& transformation) : m_transformation(transformation) {}
 
         /* Accessors */
 
-        const std::vector<Transformation>& transformations() const
-        {
-            return m_transformations;
-        }
-
-        const std::map<object_id_type, Boundary<T>>& boundaries() const
+        const Transformation& transformation() const
         {
-            return m_boundaries;
+            return m_transformation;
         }
 
     protected:
@@ -65,7 +59,8 @@ namespace handler
 
         /**
          * Convert an osmium ring of to a ring geometry by resolving the node
-         * references and applying the specified transformations.
+         * references and applying the specified transformation. The locations
+         * are copied into the ring first and transformed at once afterwards.
          *
          * @param node_refs The area ring, which extends osmium::NodeRefList
          * @returns         The ring geometry
@@ -75,25 +70,29 @@ namespace handler
         geometry::Ring<T> create_ring(const osmium::NodeRefList& node_refs)
         {
             geometry::Ring<T> ring;
+            ring.reserve(node_refs.size());
             for (const osmium::NodeRef& nr : node_refs)
             {
-                // Apply the transformations on the node
-                T x = nr.lon();
-                T y = nr.lat();
-                for (const Transformation& transformation : m_transformations)
-                {
-                    transformation->transform(x, y);
-                }
-                ring.push_back({ x, y });
+                ring.emplace_back(T(nr.lon()), T(nr.lat()));
             }
+            m_transformation.transform(ring.data(), ring.data() + ring.size());
             return ring;
         }
 
     public:
 
-        /* Osmium Methods */
+        /* Methods */
 
-        void area(const osmium::Area& area) noexcept
+        /**
+         * Converts an area to a boundary. The handler does not store the
+         * boundary, so that several handlers can convert the areas of a
+         * buffer on different threads.
+         *
+         * @param area The area
+         * @returns    The boundary with the multipolygon geometry, the
+         *             bounding box and the tag values of the area
+         */
+        Boundary<T> convert(const osmium::Area& area)
         {
             // Create the multipolygon geometry for the area
             geometry::MultiPolygon<T> multipolygon;
@@ -108,20 +107,19 @@ namespace handler
                     polygon.inners().push_back(create_ring(inner));
                 }
                 // Add the finished polygon to the multipolygon geometry
-                multipolygon.polygons().push_back(polygon);
+                multipolygon.polygons().push_back(std::move(polygon));
             }
             // Calculate the geometry bounding box
             geometry::Rectangle<T> bounds = functions::envelope(multipolygon);
             // Create the boundary with the converted geometry and other area
-            // tag values and add it to the boundary map.
-            Boundary<T> boundary{
+            // tag values
+            return Boundary<T>{
                 area.id(),
                 area.get_value_by_key("name", ""),
                 boost::lexical_cast<level_type>(area.get_value_by_key("admin_level", "0")),
-                multipolygon,
+                std::move(multipolygon),
                 bounds
             };
-            m_boundaries[area.id()] = boundary;
         }
 
     };
@@ -71,6 +71,22 @@ namespace handler
             return m_counts;
         };
 
+        /* Methods */
+
+        /**
+         * Adds the counts of another handler, such as a handler that was
+         * applied to another block of the same input.
+         *
+         * @param other The other handler
+         */
+        void merge(const CountHandler& other)
+        {
+            for (const auto& [type, count] : other.m_counts)
+            {
+                m_counts[type] += count;
+            }
+        }
+
         /* Osmium Methods */
 
         void osm_object(const osmium::OSMObject& object) noexcept
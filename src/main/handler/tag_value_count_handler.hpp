@@ -103,6 +103,23 @@ namespace handler
             return m_value_counts;
         };
 
+        /* Methods */
+
+        /**
+         * Adds the counts of another handler, such as a handler that was
+         * applied to another block of the same input.
+         *
+         * @param other The other handler
+         */
+        void merge(const TagValueCountHandler& other)
+        {
+            m_total += other.m_total;
+            for (const auto& [value, count] : other.m_value_counts)
+            {
+                m_value_counts[value] += count;
+            }
+        }
+
         /* Osmium Methods */
 
         void node(const osmium::Node& node) noexcept
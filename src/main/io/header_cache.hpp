@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace io
+{
+
+    /**
+     * The header of an OSM file is cached in a JSON file next to it, so that
+     * the file does not have to be scanned again. The cache is keyed by the
+     * size and the modification time of the file and is ignored as soon as
+     * one of them changes.
+     */
+    namespace header_cache
+    {
+
+        /**
+         * Returns the path of the header cache for an input file.
+         *
+         * @param file_path The input file path
+         * @returns         The header cache path
+         */
+        inline fs::path path(const fs::path& file_path)
+        {
+            return fs::path(file_path.string() + ".header.json");
+        }
+
+        /**
+         * Returns the size of an input file in bytes.
+         */
+        inline std::uintmax_t size(const fs::path& file_path)
+        {
+            return fs::file_size(file_path);
+        }
+
+        /**
+         * Returns the modification time of an input file.
+         */
+        inline std::time_t modified(const fs::path& file_path)
+        {
+            return fs::last_write_time(file_path);
+        }
+
+    }
+
+}
@@ -0,0 +1,349 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/anonymous_shared_memory.hpp>
+#include <boost/interprocess/exceptions.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <osmium/memory/item.hpp>
+#include <osmium/osm/item_type.hpp>
+
+#include "model/types.hpp"
+
+namespace fs = boost::filesystem;
+
+namespace io
+{
+
+    /**
+     * The prepared boundary format stores the boundaries extracted by the
+     * prepare routine in the memory layout of osmium buffers, so that they
+     * can be loaded with a memory mapping instead of decoding an OSM file.
+     *
+     * The file starts with a PreparedHeader, which is followed by one
+     * PreparedLevel entry for each admin_level and one PreparedSection
+     * entry for each section. The remaining file consists of the sections,
+     * which contain committed osmium items. The nodes carry their locations
+     * and the ways carry the locations of their node references.
+     *
+     * The objects are split into sections by the set of admin_levels that
+     * use them, which is stored as a bit mask. A relation is used by its
+     * own level, a way by the levels of its relations and its own level if
+     * it is a closed boundary way, and a node by the levels of its ways.
+     * Therefore, the objects needed for a subset of levels are exactly the
+     * objects of the sections whose mask intersects the mask of the subset.
+     * Each section starts at a multiple of SECTION_ALIGNMENT and is padded
+     * with a padding item, so that the selected sections can be mapped next
+     * to each other and read as a single buffer without copying them.
+     *
+     * All values are stored in the byte order of the machine that prepared
+     * the file, which is recorded by the BYTE_ORDER_MARK.
+     */
+    namespace prepared
+    {
+
+        /* Constants */
+
+        /**
+         * The file extension of prepared boundary files.
+         */
+        const std::string EXTENSION = ".wzb";
+
+        /**
+         * The magic bytes at the start of each prepared boundary file.
+         */
+        const char MAGIC[8] = { 'W', 'Z', 'O', 'S', 'M', 'B', 'F', '\0' };
+
+        /**
+         * The current version of the prepared boundary format.
+         */
+        const std::uint32_t VERSION = 2;
+
+        /**
+         * The byte order marker, which is read as a different value on
+         * machines with another byte order than the preparing machine.
+         */
+        const std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+        /**
+         * The alignment of the sections in bytes. It is a multiple of the
+         * page size and the allocation granularity of common systems, so
+         * that each section can be mapped on its own.
+         */
+        const std::uint64_t SECTION_ALIGNMENT = 64 * 1024;
+
+        /* Types */
+
+        /**
+         * The header of a prepared boundary file.
+         */
+        struct PreparedHeader
+        {
+            char magic[8];
+            std::uint32_t byte_order;
+            std::uint32_t version;
+            std::uint32_t level_count;
+            std::uint32_t section_count;
+            // Object counts
+            std::uint64_t nodes;
+            std::uint64_t ways;
+            std::uint64_t relations;
+            // Bounding box in osmium coordinates (min x, min y, max x, max y)
+            std::int32_t bounds[4];
+            // Offset and size of all sections in bytes
+            std::uint64_t data_offset;
+            std::uint64_t data_size;
+        };
+
+        /**
+         * The level table entry for one admin_level.
+         */
+        struct PreparedLevel
+        {
+            std::int16_t level;
+            std::int16_t padding[3];
+            std::uint64_t relations;
+        };
+
+        /**
+         * The section table entry for one set of admin_levels. The size
+         * includes the padding up to the section alignment.
+         */
+        struct PreparedSection
+        {
+            std::uint32_t mask;
+            std::uint32_t padding;
+            std::uint64_t offset;
+            std::uint64_t size;
+        };
+
+        static_assert(sizeof(PreparedHeader) % osmium::memory::align_bytes == 0, "Header has to be aligned");
+        static_assert(sizeof(PreparedLevel) % osmium::memory::align_bytes == 0, "Level entry has to be aligned");
+        static_assert(sizeof(PreparedSection) % osmium::memory::align_bytes == 0, "Section entry has to be aligned");
+
+        /**
+         * An osmium item without a type, which fills the end of a section up
+         * to the section alignment. It is skipped when a buffer is iterated.
+         */
+        class PaddingItem : public osmium::memory::Item
+        {
+        public:
+
+            explicit PaddingItem(osmium::memory::item_size_type size) noexcept
+            : osmium::memory::Item(size, osmium::item_type::undefined) {}
+
+        };
+
+        /* Functions */
+
+        /**
+         * Checks if a file is a prepared boundary file by its extension.
+         *
+         * @param file_path The file path
+         * @returns         True if the file is a prepared boundary file
+         */
+        inline bool is_prepared(const fs::path& file_path)
+        {
+            return boost::algorithm::to_lower_copy(file_path.extension().string()) == EXTENSION;
+        }
+
+        /**
+         * Retrieves the bit of an admin_level in a section mask. Levels that
+         * do not fit into the mask share the bit of level 0.
+         *
+         * @param level The admin_level
+         * @returns     The level bit
+         */
+        inline std::uint32_t level_mask(model::level_type level)
+        {
+            return level >= 0 && level < 32 ? std::uint32_t(1) << level : 1;
+        }
+
+        /**
+         * Rounds a size up to the section alignment.
+         */
+        inline std::uint64_t align_section(std::uint64_t size)
+        {
+            return (size + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+        }
+
+        /**
+         * A private memory mapping of a prepared boundary file, which
+         * validates the file header. The mapping is copy-on-write, so that
+         * changes to the mapped items are never written back to the file.
+         */
+        class PreparedFile
+        {
+        protected:
+
+            /* Members */
+
+            boost::interprocess::file_mapping m_mapping;
+            boost::interprocess::mapped_region m_region;
+
+            /**
+             * The mappings of single sections, which are placed next to
+             * each other by map_sections().
+             */
+            std::vector<boost::interprocess::mapped_region> m_sections;
+
+        public:
+
+            /* Constructors */
+
+            /**
+             * Maps a prepared boundary file into memory.
+             *
+             * @param file_path The file path
+             * @throws          std::runtime_error if the file is not a
+             *                  prepared boundary file of the current version
+             */
+            PreparedFile(const fs::path& file_path)
+            : m_mapping(file_path.string().c_str(), boost::interprocess::read_only),
+              m_region(m_mapping, boost::interprocess::copy_on_write)
+            {
+                if (m_region.get_size() < sizeof(PreparedHeader)
+                    || std::memcmp(header().magic, MAGIC, sizeof(MAGIC)) != 0)
+                {
+                    throw std::runtime_error("File " + file_path.string() + " is not a prepared boundary file");
+                }
+                if (header().byte_order != BYTE_ORDER_MARK)
+                {
+                    throw std::runtime_error(
+                        "File " + file_path.string() + " was prepared on a machine with a different "
+                        "byte order. Please prepare the file again"
+                    );
+                }
+                if (header().version != VERSION)
+                {
+                    throw std::runtime_error(
+                        "File " + file_path.string() + " was prepared with format version "
+                        + std::to_string(header().version) + ", but version "
+                        + std::to_string(VERSION) + " is required. Please prepare the file again"
+                    );
+                }
+                if (m_region.get_size() < sizeof(PreparedHeader)
+                        + header().level_count * sizeof(PreparedLevel)
+                        + header().section_count * sizeof(PreparedSection)
+                    || m_region.get_size() < header().data_offset + header().data_size)
+                {
+                    throw std::runtime_error("Prepared boundary file " + file_path.string() + " is truncated");
+                }
+                for (std::size_t i = 0; i < header().section_count; i++)
+                {
+                    const PreparedSection& section = sections()[i];
+                    if (section.offset % SECTION_ALIGNMENT != 0
+                        || section.size % SECTION_ALIGNMENT != 0
+                        || section.offset < header().data_offset
+                        || section.offset + section.size > header().data_offset + header().data_size)
+                    {
+                        throw std::runtime_error("Prepared boundary file " + file_path.string() + " has an invalid section table");
+                    }
+                }
+            }
+
+            /* Accessors */
+
+            const unsigned char* data() const
+            {
+                return static_cast<const unsigned char*>(m_region.get_address());
+            }
+
+            unsigned char* data()
+            {
+                return static_cast<unsigned char*>(m_region.get_address());
+            }
+
+            std::size_t size() const
+            {
+                return m_region.get_size();
+            }
+
+            const PreparedHeader& header() const
+            {
+                return *reinterpret_cast<const PreparedHeader*>(data());
+            }
+
+            const PreparedLevel* levels() const
+            {
+                return reinterpret_cast<const PreparedLevel*>(data() + sizeof(PreparedHeader));
+            }
+
+            const PreparedSection* sections() const
+            {
+                return reinterpret_cast<const PreparedSection*>(levels() + header().level_count);
+            }
+
+            /* Methods */
+
+            /**
+             * Maps a list of sections next to each other, so that they can be
+             * read as a single buffer without copying them. An address range
+             * for all sections is reserved first and the sections are mapped
+             * into it afterwards. The mappings are kept until the file is
+             * destroyed.
+             *
+             * @param selected The sections in the order of the mapping
+             * @returns        The start of the mapped sections or nullptr if
+             *                 the sections could not be mapped next to each
+             *                 other, such as if the address range was taken
+             *                 by another thread in the meantime
+             */
+            unsigned char* map_sections(const std::vector<const PreparedSection*>& selected)
+            {
+                std::size_t page_size = boost::interprocess::mapped_region::get_page_size();
+                if (selected.empty() || SECTION_ALIGNMENT % page_size != 0)
+                {
+                    return nullptr;
+                }
+                std::size_t size = 0;
+                for (const PreparedSection* section : selected)
+                {
+                    size += section->size;
+                }
+
+                unsigned char* address = nullptr;
+                {
+                    // Find a free address range, which is released before the
+                    // sections are mapped into it
+                    boost::interprocess::mapped_region reserved = boost::interprocess::anonymous_shared_memory(size);
+                    address = static_cast<unsigned char*>(reserved.get_address());
+                }
+                std::size_t first = m_sections.size();
+                try
+                {
+                    std::size_t offset = 0;
+                    for (const PreparedSection* section : selected)
+                    {
+                        m_sections.emplace_back(
+                            m_mapping,
+                            boost::interprocess::copy_on_write,
+                            section->offset,
+                            section->size,
+                            address + offset
+                        );
+                        offset += section->size;
+                    }
+                }
+                catch (const boost::interprocess::interprocess_exception&)
+                {
+                    m_sections.erase(m_sections.begin() + first, m_sections.end());
+                    return nullptr;
+                }
+                return address;
+            }
+
+        };
+
+    }
+
+}
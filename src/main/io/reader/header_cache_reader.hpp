@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+#include <osmium/io/file_compression.hpp>
+#include <osmium/io/file_format.hpp>
+#include <osmium/osm/box.hpp>
+#include <osmium/osm/location.hpp>
+
+#include "io/header_cache.hpp"
+#include "io/reader/reader.hpp"
+#include "model/header.hpp"
+#include "model/types.hpp"
+
+namespace io
+{
+
+    using json = nlohmann::ordered_json;
+
+    /**
+     * A reader for the cached header of an OSM file.
+     */
+    class HeaderCacheReader : public Reader<model::Header>
+    {
+    protected:
+
+        /* Members */
+
+        /**
+         * The path to the OSM file of the cached header.
+         */
+        fs::path m_input;
+
+    public:
+
+        /* Constructors */
+
+        HeaderCacheReader(fs::path file_path)
+        : Reader<model::Header>(header_cache::path(file_path)), m_input(file_path) {}
+
+        /* Methods */
+
+        /**
+         * Checks if a header cache exists for the input file and if it
+         * matches the current size and modification time of the file.
+         *
+         * @param counted If set, the cache is only valid if the nodes and
+         *                ways of the input file were counted
+         * @returns       True if the cached header can be used
+         */
+        bool valid(bool counted = false) const
+        {
+            if (!fs::exists(m_path))
+            {
+                return false;
+            }
+            try
+            {
+                std::ifstream ifs{ m_path };
+                json data = json::parse(ifs);
+                return data.at("source").at("size").get<std::uintmax_t>() == header_cache::size(m_input)
+                    && data.at("source").at("modified").get<std::time_t>() == header_cache::modified(m_input)
+                    && (!counted || data.value("counted", true));
+            }
+            catch (const std::exception& e)
+            {
+                return false;
+            }
+        }
+
+        /* Override Methods */
+
+        model::Header read() override
+        {
+            std::ifstream ifs{ m_path };
+            json data = json::parse(ifs);
+
+            // Parse the level distribution
+            std::map<model::level_type, std::size_t> levels;
+            for (const auto& [level, count] : data.at("levels").items())
+            {
+                levels[static_cast<model::level_type>(std::stoi(level))] = count.get<std::size_t>();
+            }
+
+            const json& bounds = data.at("bounds");
+            return model::Header{
+                data.at("name").get<std::string>(),
+                static_cast<osmium::io::file_format>(data.at("format").get<int>()),
+                static_cast<osmium::io::file_compression>(data.at("compression").get<int>()),
+                data.at("size").get<std::size_t>(),
+                data.at("nodes").get<std::size_t>(),
+                data.at("ways").get<std::size_t>(),
+                data.at("relations").get<std::size_t>(),
+                osmium::Box{
+                    osmium::Location{ bounds.at(0).get<std::int32_t>(), bounds.at(1).get<std::int32_t>() },
+                    osmium::Location{ bounds.at(2).get<std::int32_t>(), bounds.at(3).get<std::int32_t>() }
+                },
+                data.at("boundaries").get<std::size_t>(),
+                levels,
+                data.value("counted", true)
+            };
+        }
+
+    };
+
+}
@@ -2,6 +2,8 @@
 
 #include <osmium/io/file.hpp>
 #include <osmium/io/reader.hpp>
+#include <osmium/osm/box.hpp>
+#include <osmium/osm/entity_bits.hpp>
 #include <osmium/visitor.hpp>
 
 #include "model/types.hpp"
@@ -19,16 +21,70 @@ namespace io
      */
     class HeaderReader : public Reader<model::Header>
     {
+    protected:
+
+        /* Members */
+
+        /**
+         * The fast mode flag. If set, only the relations of the input file
+         * are read. The bounds are taken from the file header and nodes and
+         * ways are not counted.
+         */
+        bool m_fast = false;
+
+        /* Helper Methods */
+
+        model::Header read_fast()
+        {
+            osmium::io::File file{ m_path.string() };
+            osmium::io::Reader reader{ file, osmium::osm_entity_bits::relation };
+
+            // The bounding box is optional in OSM files. If it is missing,
+            // the bounds remain undefined.
+            osmium::Box bounds = reader.header().joined_boxes();
+
+            // Count the relations and their levels
+            handler::CountHandler count_handler{ osmium::item_type::relation };
+            handler::TagValueCountHandler<model::level_type> level_count_handler{
+                "admin_level",
+                osmium::item_type::relation
+            };
+            osmium::apply(reader, count_handler, level_count_handler);
+            reader.close();
+
+            // Return results
+            return model::Header{
+                m_path.string(),
+                file.format(),
+                file.compression(),
+                fs::file_size(m_path),
+                0,
+                0,
+                count_handler.count(osmium::item_type::relation),
+                bounds,
+                level_count_handler.total(),
+                level_count_handler.counts(),
+                false
+            };
+        }
+
     public:
 
         /* Constructors */
 
         HeaderReader(fs::path file_path) : Reader<model::Header>(file_path) {}
 
+        HeaderReader(fs::path file_path, bool fast) : Reader<model::Header>(file_path), m_fast(fast) {}
+
         /* Override Methods */
 
         model::Header read() override
         {
+            if (m_fast)
+            {
+                return read_fast();
+            }
+
             // The Reader is initialized here with an osmium::io::File, but could
             // also be directly initialized with a file name.
             osmium::io::File file{ m_path.string() };
@@ -1,13 +1,26 @@
 #pragma once
 
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
 #include <osmium/memory/buffer.hpp>
-#include <osmium/relations/relations_manager.hpp>
 #include <osmium/tags/tags_filter.hpp>
 #include <osmium/io/any_input.hpp>
+#include <osmium/osm/entity_bits.hpp>
+#include <osmium/thread/pool.hpp>
+#include <osmium/visitor.hpp>
 
 #include "handler/boundary_manager.hpp"
+#include "handler/bounds_handler.hpp"
+#include "handler/count_handler.hpp"
+#include "handler/tag_value_count_handler.hpp"
+#include "io/reader/pbf_index.hpp"
 #include "io/reader/reader.hpp"
+#include "model/header.hpp"
 #include "model/types.hpp"
+#include "util/osm.hpp"
+#include "util/parallel.hpp"
 
 namespace io
 {
@@ -34,15 +47,184 @@ namespace io
          */
         std::set<model::level_type> m_levels = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
 
+        /**
+         * The number of worker threads for decoding the input blocks and
+         * writing the result (0 = auto).
+         */
+        std::size_t m_threads = 0;
+
+        /**
+         * The header of the input file, which is collected while the
+         * boundaries are read.
+         */
+        model::Header m_header;
+
     public:
 
         /* Constructors */
 
         BoundaryReader(fs::path file_path) : Reader<osmium::memory::Buffer>(file_path) {}
 
+        BoundaryReader(fs::path file_path, std::size_t threads)
+        : Reader<osmium::memory::Buffer>(file_path), m_threads(threads) {}
+
         BoundaryReader(fs::path file_path, const std::set<model::level_type>& levels)
         : Reader<osmium::memory::Buffer>(file_path), m_levels(levels) {}
 
+        BoundaryReader(fs::path file_path, const std::set<model::level_type>& levels, std::size_t threads)
+        : Reader<osmium::memory::Buffer>(file_path), m_levels(levels), m_threads(threads) {}
+
+        /* Accessors */
+
+        /**
+         * Returns the header of the input file. The header is only available
+         * after the boundaries were read.
+         */
+        const model::Header& header() const
+        {
+            return m_header;
+        }
+
+    protected:
+
+        /* Helper Methods */
+
+        /**
+         * Reads a PBF file whose objects are sorted by type and id, so that
+         * the nodes are followed by the ways and the ways by the relations.
+         *
+         * The data blobs are indexed first, which only skips over the blob
+         * headers. The blobs are then decoded in reverse order, so that all
+         * relations are passed to the manager before the ways and all ways
+         * before the nodes. This way, each blob is decompressed and decoded
+         * exactly once, while the manager still knows which ways and nodes
+         * to keep when they are read.
+         *
+         * The blobs are processed in batches. The blobs of a batch are
+         * decoded on the worker threads, which also apply a copy of each
+         * handler and filter the relations of their blocks. The ways and
+         * nodes of the blocks are filtered on the worker threads as well,
+         * after the results of the previous step were added to the manager.
+         * The results are added in block order, so they do not depend on the
+         * number of threads.
+         *
+         * @param manager  The boundary manager
+         * @param handlers The handlers for the header, which are merged with
+         *                 the handlers of the blocks
+         */
+        template <typename... THandlers>
+        void read_indexed(handler::BoundaryManager& manager, THandlers&... handlers) const
+        {
+            PBFIndex index{ m_path };
+
+            // The handlers of the blocks are copied from the unused handlers
+            const std::tuple<THandlers...> initial{ handlers... };
+
+            std::size_t batch_size = 4 * util::thread_count(m_threads);
+            for (std::size_t last = index.size(); last > 0;)
+            {
+                std::size_t first = last > batch_size ? last - batch_size : 0;
+                std::size_t count = last - first;
+
+                // Decode the blocks of the batch in reverse order and filter
+                // their relations
+                std::vector<osmium::memory::Buffer> blocks(count);
+                std::vector<osmium::memory::Buffer> relations(count);
+                std::vector<std::tuple<THandlers...>> block_handlers(count, initial);
+                util::parallel_for(count, m_threads, [&](std::size_t b)
+                {
+                    blocks[b] = index.decode(last - 1 - b);
+                    std::apply([&](auto&... block_handler)
+                    {
+                        osmium::apply(blocks[b], block_handler...);
+                    }, block_handlers[b]);
+                    relations[b] = manager.filter_relations(blocks[b]);
+                });
+                for (std::size_t b = 0; b < count; b++)
+                {
+                    std::apply([&](const auto&... block_handler)
+                    {
+                        (handlers.merge(block_handler), ...);
+                    }, block_handlers[b]);
+                    manager.add_relations(relations[b]);
+                }
+
+                // Filter the ways of the blocks
+                std::vector<osmium::memory::Buffer> ways(count);
+                util::parallel_for(count, m_threads, [&](std::size_t b)
+                {
+                    ways[b] = manager.filter_ways(blocks[b]);
+                });
+                for (std::size_t b = 0; b < count; b++)
+                {
+                    manager.add_ways(ways[b]);
+                }
+
+                // All ways were added once a block contains nodes, so the
+                // complete relations can be determined before the nodes of
+                // the blocks are filtered
+                bool nodes = std::any_of(blocks.begin(), blocks.end(), [](const osmium::memory::Buffer& block)
+                {
+                    auto block_nodes = block.select<osmium::Node>();
+                    return block_nodes.begin() != block_nodes.end();
+                });
+                if (nodes)
+                {
+                    manager.complete_relations();
+                    std::vector<handler::BoundaryManager::location_list> locations(count);
+                    util::parallel_for(count, m_threads, [&](std::size_t b)
+                    {
+                        locations[b] = manager.filter_nodes(blocks[b]);
+                    });
+                    for (std::size_t b = 0; b < count; b++)
+                    {
+                        manager.add_nodes(locations[b]);
+                    }
+                }
+
+                last = first;
+            }
+            manager.complete_relations();
+        }
+
+        /**
+         * Reads a file of any format in three passes, one for each object
+         * type. This is needed if the objects of the file are not sorted, as
+         * the ways and nodes to keep are only known after the relations and
+         * the ways were read. Each pass decodes the whole file again.
+         */
+        template <typename... THandlers>
+        void read_passes(handler::BoundaryManager& manager, THandlers&... handlers) const
+        {
+            osmium::io::File file{ m_path.string() };
+
+            // The thread pool that decodes the input blocks for all passes.
+            osmium::thread::Pool pool{ static_cast<int>(util::thread_count(m_threads)) };
+
+            // First pass through the file: Read all relations and pass them to
+            // the boundary manager. This will also filter out any relations that
+            // do not match the filter.
+            osmium::io::Reader relation_reader{ file, pool, osmium::osm_entity_bits::relation };
+            osmium::apply(relation_reader, manager, handlers...);
+            relation_reader.close();
+
+            // Second pass through the file: Read the ways and copy the member
+            // ways and boundary ways. Afterwards, the complete relations and
+            // the nodes of their ways are marked.
+            osmium::io::Reader way_reader{ file, pool, osmium::osm_entity_bits::way };
+            osmium::apply(way_reader, manager, handlers...);
+            way_reader.close();
+            manager.complete_relations();
+
+            // Third pass through the file: Read the nodes and store the
+            // locations of the marked nodes.
+            osmium::io::Reader node_reader{ file, pool, osmium::osm_entity_bits::node };
+            osmium::apply(node_reader, manager, handlers...);
+            node_reader.close();
+        }
+
+    public:
+
         /* Override Methods */
 
         osmium::memory::Buffer read() override
@@ -51,69 +233,79 @@ namespace io
 
             // Prepare the tag filter for the BoundaryManager with the
             // specified administrative levels
-            osmium::TagsFilter filter{ false };
-            for (const model::level_type& level : m_levels)
+            osmium::TagsFilter filter = util::level_filter(m_levels);
+
+            // Instantiate the boundary manager, which will extract all
+            // administrative boundary relations for the specified admin_levels
+            // as well as the associated ways and nodes.
+            handler::BoundaryManager manager{ filter };
+
+            // The handlers for the file header are applied along with the
+            // boundary manager, so that no separate header pass is needed.
+            handler::CountHandler count_handler{
+                osmium::item_type::node,
+                osmium::item_type::way,
+                osmium::item_type::relation
+            };
+            handler::TagValueCountHandler<model::level_type> level_count_handler{
+                "admin_level",
+                osmium::item_type::relation
+            };
+            handler::BoundsHandler bounds_handler;
+
+            if (PBFIndex::is_indexable(file))
+            {
+                read_indexed(manager, count_handler, level_count_handler, bounds_handler);
+            }
+            else
             {
-                filter.add_rule(true, "admin_level", std::to_string(level));
+                read_passes(manager, count_handler, level_count_handler, bounds_handler);
             }
 
-            // Instantiate the boundary filter, which will extract all
-            // administrative boundary relation ids for the specified 
-            // admin_levelsas as well as the associated way and node ids.
-            handler::BoundaryManager manager{ filter };
+            // Create the result buffer from the collected objects. The nodes
+            // are written first by sweeping over the marked node ids, followed
+            // by the ways and relations of the complete boundaries. The ways
+            // carry the locations of their nodes, so that later stages do not
+            // need a location index. The size of the collected objects is
+            // known at this point, so the buffer is allocated only once.
+            osmium::memory::Buffer result{
+                std::max(manager.output_size(), std::size_t(1024)),
+                osmium::memory::Buffer::auto_grow::yes
+            };
+            manager.write_nodes(result, m_threads);
+            manager.write_ways(result, m_threads);
+            manager.write_relations(result);
 
-            // First pass through the file: Read all relations and pass them to
-            // the boundary manager. This will also filter out any relations that
-            // do not match the filter.
-            osmium::relations::read_relations(file, manager);
-
-            // Second pass through the file: Extract the osmium objects through the
-            // reader and pass them to the boundary manager, such that it can mark
-            // the nodes, ways and relations
-            osmium::io::Reader manager_reader{file};
-            osmium::apply(manager_reader, manager.handler());
-            manager.read();
-            manager_reader.close();
-            
-            // Extract the matching ids from the manager and prepare the result buffer
-            auto matching_ids = manager.matching_ids();
-            osmium::memory::Buffer result{file.size(), osmium::memory::Buffer::auto_grow::yes};
+            m_header = model::Header{
+                m_path.string(),
+                file.format(),
+                file.compression(),
+                fs::file_size(m_path),
+                count_handler.count(osmium::item_type::node),
+                count_handler.count(osmium::item_type::way),
+                count_handler.count(osmium::item_type::relation),
+                bounds_handler.bounds(),
+                level_count_handler.total(),
+                level_count_handler.counts()
+            };
 
             // If there were relations in the input with members that weren't
             // part of the input file (which often happens for extracts), write
-            // the IDs of the incomplete relations to stderr.
-            std::vector<osmium::object_id_type> incomplete_relations_ids;
-            manager.for_each_incomplete_relation([&](const osmium::relations::RelationHandle& handle) {
-                incomplete_relations_ids.push_back(handle->id());
-            });
-            if (!incomplete_relations_ids.empty())
+            // the number of the incomplete relations and missing nodes to stderr.
+            if (manager.incomplete_relations() > 0)
             {
                 std::cerr << "[Warning] Skipped missing members for "
-                    << incomplete_relations_ids.size()
+                    << manager.incomplete_relations()
                     << " boundaries.\n";
             }
-
-            // Third pass trough the file: Copy the marked object into the result buffer
-            // through yet another reader. using the matching ids found by the boundary
-            // manager.
-            osmium::io::Reader copy_reader{file};
-            while (osmium::memory::Buffer buffer = copy_reader.read())
+            if (manager.missing_nodes() > 0)
             {
-                // Copy the marked objects
-                for (auto& object : buffer.select<osmium::OSMObject>())
-                {
-                    if (matching_ids(object.type()).get(object.positive_id()))
-                    {
-                        // Copy element to the buffer
-                        result.add_item(object);
-                        result.commit();
-                    }
-                }
+                std::cerr << "[Warning] Skipped "
+                    << manager.missing_nodes()
+                    << " missing boundary nodes.\n";
             }
-            copy_reader.close();
 
-            // Close the reader and return the buffer.
-            return std::move(result);
+            return result;
         }
 
     };
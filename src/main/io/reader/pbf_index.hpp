@@ -0,0 +1,222 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <osmium/io/any_input.hpp>
+#include <osmium/io/detail/pbf_decoder.hpp>
+#include <osmium/io/file.hpp>
+#include <osmium/io/header.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/osm/entity_bits.hpp>
+
+#include <protozero/pbf_reader.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace io
+{
+
+    /**
+     * An index of the data blobs of an OSM PBF file, which allows decoding
+     * single blobs in an arbitrary order.
+     *
+     * A PBF file is a sequence of blobs, each preceded by its size as a
+     * 4-byte big-endian integer and a BlobHeader message, which contains
+     * the type and the size of the blob. The index is built by skipping
+     * from header to header through a memory mapping of the file, so that
+     * no blob has to be decompressed to build it.
+     *
+     * For more information, refer to
+     * https://wiki.openstreetmap.org/wiki/PBF_Format
+     */
+    class PBFIndex
+    {
+    public:
+
+        /* Types */
+
+        /**
+         * The position of a data blob in the file.
+         */
+        struct Blob
+        {
+            std::size_t offset;
+            std::size_t size;
+        };
+
+    protected:
+
+        /* Constants */
+
+        /**
+         * The maximum size of a BlobHeader message as defined by the format.
+         */
+        static constexpr std::size_t MAX_HEADER_SIZE = 64 * 1024;
+
+        /**
+         * The maximum size of a blob as defined by the format.
+         */
+        static constexpr std::size_t MAX_BLOB_SIZE = 32 * 1024 * 1024;
+
+        /* Members */
+
+        boost::interprocess::file_mapping m_mapping;
+        boost::interprocess::mapped_region m_region;
+
+        /**
+         * The OSMData blobs in file order.
+         */
+        std::vector<Blob> m_blobs;
+
+        /* Helper Methods */
+
+        const char* data() const
+        {
+            return static_cast<const char*>(m_region.get_address());
+        }
+
+        /**
+         * Collects the positions of the OSMData blobs by skipping over the
+         * blobs of the file.
+         *
+         * @param file_path The file path, which is used for error messages
+         * @throws          std::runtime_error if the file is truncated or
+         *                  contains an invalid blob header
+         */
+        void build(const fs::path& file_path)
+        {
+            std::size_t size = m_region.get_size();
+            std::size_t position = 0;
+            while (position < size)
+            {
+                if (size - position < 4)
+                {
+                    throw std::runtime_error("PBF file " + file_path.string() + " is truncated");
+                }
+                const unsigned char* length_bytes = reinterpret_cast<const unsigned char*>(data() + position);
+                std::size_t header_size = (std::size_t(length_bytes[0]) << 24)
+                    | (std::size_t(length_bytes[1]) << 16)
+                    | (std::size_t(length_bytes[2]) << 8)
+                    | std::size_t(length_bytes[3]);
+                position += 4;
+                if (header_size > MAX_HEADER_SIZE || size - position < header_size)
+                {
+                    throw std::runtime_error("PBF file " + file_path.string() + " has an invalid blob header");
+                }
+
+                // Read the type and the size of the blob from the header
+                std::string type;
+                std::int32_t blob_size = -1;
+                protozero::pbf_reader header{ data() + position, header_size };
+                while (header.next())
+                {
+                    switch (header.tag())
+                    {
+                        case 1:
+                            type = header.get_string();
+                            break;
+                        case 3:
+                            blob_size = header.get_int32();
+                            break;
+                        default:
+                            header.skip();
+                    }
+                }
+                position += header_size;
+                if (blob_size < 0 || std::size_t(blob_size) > MAX_BLOB_SIZE || size - position < std::size_t(blob_size))
+                {
+                    throw std::runtime_error("PBF file " + file_path.string() + " has an invalid blob header");
+                }
+                if (type == "OSMData")
+                {
+                    m_blobs.push_back(Blob{ position, std::size_t(blob_size) });
+                }
+                position += std::size_t(blob_size);
+            }
+        }
+
+    public:
+
+        /* Constructors */
+
+        /**
+         * Maps a PBF file into memory and indexes its data blobs.
+         *
+         * @param file_path The file path
+         */
+        PBFIndex(const fs::path& file_path)
+        : m_mapping(file_path.string().c_str(), boost::interprocess::read_only),
+          m_region(m_mapping, boost::interprocess::read_only)
+        {
+            build(file_path);
+        }
+
+        /* Accessors */
+
+        const std::vector<Blob>& blobs() const
+        {
+            return m_blobs;
+        }
+
+        std::size_t size() const
+        {
+            return m_blobs.size();
+        }
+
+        /* Methods */
+
+        /**
+         * Decompresses and decodes a data blob. This method does not change
+         * the index, so it can be called for different blobs on multiple
+         * threads at once.
+         *
+         * @param index The index of the blob in file order
+         * @param types The object types to decode
+         * @returns     The buffer with the objects of the blob
+         */
+        osmium::memory::Buffer decode(std::size_t index, osmium::osm_entity_bits::type types = osmium::osm_entity_bits::all) const
+        {
+            const Blob& blob = m_blobs.at(index);
+            osmium::io::detail::PBFDataBlobDecoder decoder{
+                std::string(data() + blob.offset, blob.size),
+                types,
+                osmium::io::read_meta::yes
+            };
+            return decoder();
+        }
+
+        /* Static Methods */
+
+        /**
+         * Checks if the blobs of a file can be processed with an index in
+         * type order, which requires a PBF file whose header states that its
+         * objects are sorted by type and id. The nodes are stored first, then
+         * the ways and then the relations.
+         *
+         * @param file The file
+         * @returns    True if the file is a sorted PBF file
+         */
+        static bool is_indexable(const osmium::io::File& file)
+        {
+            if (file.format() != osmium::io::file_format::pbf || file.filename().empty())
+            {
+                return false;
+            }
+            // Only the header block is decoded when no objects are requested
+            osmium::io::Reader reader{ file, osmium::osm_entity_bits::nothing };
+            osmium::io::Header header = reader.header();
+            reader.close();
+            return header.get("sorting") == "Type_then_ID";
+        }
+
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include <osmium/io/file_compression.hpp>
+#include <osmium/io/file_format.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/osm/box.hpp>
+#include <osmium/osm/location.hpp>
+#include <osmium/osm/node.hpp>
+#include <osmium/osm/relation.hpp>
+#include <osmium/osm/way.hpp>
+
+#include "io/prepared.hpp"
+#include "io/reader/reader.hpp"
+#include "model/header.hpp"
+#include "model/types.hpp"
+
+namespace io
+{
+
+    /**
+     * A reader that loads the boundaries of a prepared boundary file.
+     *
+     * The file is memory mapped, so that no decoding is needed. Only the
+     * sections whose level mask intersects the requested levels are read,
+     * which contain exactly the relations of the requested levels, their
+     * ways, the closed boundary ways of these levels and the nodes of the
+     * ways. The result buffer does not own its memory, but references the
+     * mapped sections directly. If all sections are selected, the mapping of
+     * the whole file is used. Otherwise, the selected sections are mapped
+     * next to each other. Only if this fails, the sections are copied into
+     * an owning result buffer. The reader keeps the mapping, which has to
+     * outlive the result buffer.
+     */
+    class PreparedReader : public Reader<osmium::memory::Buffer>
+    {
+    protected:
+
+        /**
+         * The admin_level filter. Only the relations with an administrative
+         * level contained in this set will be loaded. If empty, all
+         * relations will be loaded.
+         */
+        std::set<model::level_type> m_levels;
+
+        /**
+         * The mapping of the file, which is referenced by the result buffer.
+         */
+        std::shared_ptr<prepared::PreparedFile> m_file;
+
+    public:
+
+        /* Constructors */
+
+        PreparedReader(fs::path file_path) : Reader<osmium::memory::Buffer>(file_path) {}
+
+        PreparedReader(fs::path file_path, const std::set<model::level_type>& levels)
+        : Reader<osmium::memory::Buffer>(file_path), m_levels(levels) {}
+
+        /* Accessors */
+
+        /**
+         * Returns the mapping of the file. The mapping is only available
+         * after the boundaries were read.
+         */
+        const std::shared_ptr<prepared::PreparedFile>& file() const
+        {
+            return m_file;
+        }
+
+    protected:
+
+        /* Helper Methods */
+
+        /**
+         * Retrieves the level mask of the requested levels.
+         */
+        std::uint32_t mask() const
+        {
+            if (m_levels.empty())
+            {
+                return ~std::uint32_t(0);
+            }
+            std::uint32_t mask = 0;
+            for (const model::level_type level : m_levels)
+            {
+                mask |= prepared::level_mask(level);
+            }
+            return mask;
+        }
+
+    public:
+
+        /* Override Methods */
+
+        osmium::memory::Buffer read() override
+        {
+            m_file = std::make_shared<prepared::PreparedFile>(m_path);
+            prepared::PreparedFile& file = *m_file;
+            const prepared::PreparedHeader& header = file.header();
+
+            // Determine the selected sections and their size
+            std::uint32_t selection = mask();
+            std::vector<const prepared::PreparedSection*> sections;
+            std::size_t size = 0;
+            for (std::size_t i = 0; i < header.section_count; i++)
+            {
+                const prepared::PreparedSection& section = file.sections()[i];
+                if (section.mask & selection)
+                {
+                    sections.push_back(&section);
+                    size += section.size;
+                }
+            }
+            if (size == 0)
+            {
+                return osmium::memory::Buffer{ 1024, osmium::memory::Buffer::auto_grow::yes };
+            }
+
+            // The sections are stored in mask order without gaps, so if all
+            // of them are selected, the mapping of the file is used
+            if (sections.size() == header.section_count)
+            {
+                return osmium::memory::Buffer{ file.data() + header.data_offset, size };
+            }
+
+            // Otherwise, map the selected sections next to each other
+            unsigned char* data = file.map_sections(sections);
+            if (data != nullptr)
+            {
+                return osmium::memory::Buffer{ data, size };
+            }
+
+            // Copy the sections if they could not be mapped. The result
+            // buffer is allocated once for all selected sections.
+            osmium::memory::Buffer result{ size, osmium::memory::Buffer::auto_grow::yes };
+            for (const prepared::PreparedSection* section : sections)
+            {
+                std::memcpy(result.reserve_space(section->size), file.data() + section->offset, section->size);
+                result.commit();
+            }
+            return result;
+        }
+
+    };
+
+    /**
+     * A reader that retrieves the header of a prepared boundary file. Since
+     * the prepared file stores its object counts, bounds and level
+     * histogram, no objects have to be read.
+     */
+    class PreparedHeaderReader : public Reader<model::Header>
+    {
+    public:
+
+        /* Constructors */
+
+        PreparedHeaderReader(fs::path file_path) : Reader<model::Header>(file_path) {}
+
+        /* Override Methods */
+
+        model::Header read() override
+        {
+            prepared::PreparedFile file{ m_path };
+            const prepared::PreparedHeader& header = file.header();
+
+            // Retrieve the level histogram
+            std::map<model::level_type, std::size_t> levels;
+            std::size_t boundaries = 0;
+            for (std::size_t i = 0; i < header.level_count; i++)
+            {
+                const prepared::PreparedLevel& level = file.levels()[i];
+                levels[level.level] = level.relations;
+                boundaries += level.relations;
+            }
+
+            // Return results
+            return model::Header{
+                m_path.string(),
+                osmium::io::file_format::unknown,
+                osmium::io::file_compression::none,
+                fs::file_size(m_path),
+                header.nodes,
+                header.ways,
+                header.relations,
+                osmium::Box{
+                    osmium::Location{ header.bounds[0], header.bounds[1] },
+                    osmium::Location{ header.bounds[2], header.bounds[3] }
+                },
+                boundaries,
+                levels
+            };
+        }
+
+    };
+
+}
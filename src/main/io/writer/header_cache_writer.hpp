@@ -0,0 +1,76 @@
+#pragma once
+
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+#include "io/header_cache.hpp"
+#include "io/writer/writer.hpp"
+#include "model/header.hpp"
+
+namespace io
+{
+
+    using json = nlohmann::ordered_json;
+
+    /**
+     * A writer that caches the header of an OSM file next to the file.
+     */
+    class HeaderCacheWriter : public Writer<model::Header>
+    {
+    protected:
+
+        /* Members */
+
+        /**
+         * The path to the OSM file of the cached header.
+         */
+        fs::path m_input;
+
+    public:
+
+        /* Constructors */
+
+        HeaderCacheWriter(fs::path file_path)
+        : Writer<model::Header>(header_cache::path(file_path)), m_input(file_path) {}
+
+        /* Override Methods */
+
+        void write(model::Header&& header) override
+        {
+            json data;
+            data["source"]["size"] = header_cache::size(m_input);
+            data["source"]["modified"] = header_cache::modified(m_input);
+            data["name"] = header.name;
+            data["format"] = static_cast<int>(header.format);
+            data["compression"] = static_cast<int>(header.compression);
+            data["size"] = header.size;
+            data["nodes"] = header.nodes;
+            data["ways"] = header.ways;
+            data["relations"] = header.relations;
+            data["bounds"] = {
+                header.bounds.bottom_left().x(),
+                header.bounds.bottom_left().y(),
+                header.bounds.top_right().x(),
+                header.bounds.top_right().y()
+            };
+            data["boundaries"] = header.boundaries;
+            data["levels"] = json::object();
+            for (const auto& [level, count] : header.levels)
+            {
+                data["levels"][std::to_string(level)] = count;
+            }
+            data["counted"] = header.counted;
+            std::ofstream ofs{ m_path, std::ios::trunc };
+            ofs << data.dump() << std::endl;
+            if (!ofs)
+            {
+                throw std::runtime_error("Could not write header cache " + m_path.string());
+            }
+        }
+
+    };
+
+}
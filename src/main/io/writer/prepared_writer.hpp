@@ -0,0 +1,254 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <new>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/lexical_cast/bad_lexical_cast.hpp>
+
+#include <osmium/memory/buffer.hpp>
+#include <osmium/osm/box.hpp>
+#include <osmium/osm/node.hpp>
+#include <osmium/osm/relation.hpp>
+#include <osmium/osm/way.hpp>
+#include <osmium/tags/tags_filter.hpp>
+
+#include "io/prepared.hpp"
+#include "io/writer/writer.hpp"
+#include "model/types.hpp"
+#include "util/osm.hpp"
+
+namespace io
+{
+
+    /**
+     * A writer for prepared boundary files, which can be memory mapped by
+     * the PreparedReader.
+     */
+    class PreparedWriter : public Writer<osmium::memory::Buffer>
+    {
+    public:
+
+        /* Constructors */
+
+        PreparedWriter(fs::path file_path) : Writer<osmium::memory::Buffer>(file_path) {}
+
+    protected:
+
+        /* Helper Methods */
+
+        /**
+         * Parses the admin_level of an object. Objects with an invalid level
+         * are kept in level 0.
+         */
+        static model::level_type parse_level(const osmium::OSMObject& object)
+        {
+            try
+            {
+                return boost::lexical_cast<model::level_type>(object.get_value_by_key("admin_level", "0"));
+            }
+            catch (boost::bad_lexical_cast& e)
+            {
+                return 0;
+            }
+        }
+
+        /**
+         * Retrieves the section buffer for a level mask.
+         */
+        static osmium::memory::Buffer& section_buffer(std::map<std::uint32_t, osmium::memory::Buffer>& sections, std::uint32_t mask)
+        {
+            auto it = sections.find(mask);
+            if (it == sections.end())
+            {
+                it = sections.emplace(
+                    mask,
+                    osmium::memory::Buffer{ 1024, osmium::memory::Buffer::auto_grow::yes }
+                ).first;
+            }
+            return it->second;
+        }
+
+        /**
+         * Appends the committed items of a section buffer to the output,
+         * followed by a padding item up to the section alignment.
+         */
+        void write_section(std::ofstream& ofs, const osmium::memory::Buffer& buffer)
+        {
+            ofs.write(reinterpret_cast<const char*>(buffer.data()), buffer.committed());
+            std::size_t padding = prepared::align_section(buffer.committed()) - buffer.committed();
+            if (padding > 0)
+            {
+                std::vector<unsigned char> bytes(padding, 0);
+                new (bytes.data()) prepared::PaddingItem(padding);
+                ofs.write(reinterpret_cast<const char*>(bytes.data()), padding);
+            }
+        }
+
+        /**
+         * Pads the output with zeros up to an offset.
+         */
+        void write_padding(std::ofstream& ofs, std::uint64_t size)
+        {
+            std::vector<char> bytes(size, 0);
+            ofs.write(bytes.data(), size);
+        }
+
+    public:
+
+        /* Override Methods */
+
+        void write(osmium::memory::Buffer&& buffer) override
+        {
+            prepared::PreparedHeader header{};
+            std::memcpy(header.magic, prepared::MAGIC, sizeof(prepared::MAGIC));
+            header.byte_order = prepared::BYTE_ORDER_MARK;
+            header.version = prepared::VERSION;
+
+            // Determine the level masks of the relations and their member
+            // ways, and count the relations of each level
+            std::map<model::level_type, std::uint64_t> counts;
+            std::unordered_map<osmium::object_id_type, std::uint32_t> way_masks;
+            for (const osmium::Relation& relation : buffer.select<osmium::Relation>())
+            {
+                model::level_type relation_level = parse_level(relation);
+                counts[relation_level]++;
+                header.relations++;
+                for (const osmium::RelationMember& member : relation.members())
+                {
+                    if (member.type() == osmium::item_type::way)
+                    {
+                        way_masks[member.ref()] |= prepared::level_mask(relation_level);
+                    }
+                }
+            }
+
+            // Add the levels of the closed boundary ways to the masks, so
+            // that they are kept for their own level. A way without any
+            // level is kept in every level.
+            osmium::TagsFilter any{ true };
+            for (const osmium::Way& way : buffer.select<osmium::Way>())
+            {
+                std::uint32_t& mask = way_masks[way.id()];
+                if (way.tags().has_key("admin_level") && util::is_area_way(way, any))
+                {
+                    mask |= prepared::level_mask(parse_level(way));
+                }
+                if (mask == 0)
+                {
+                    mask = ~std::uint32_t(0);
+                }
+                header.ways++;
+            }
+
+            // The nodes take the levels of their ways. Nodes without any way
+            // are kept in every level.
+            std::vector<std::pair<osmium::object_id_type, std::uint32_t>> node_masks;
+            for (const osmium::Node& node : buffer.select<osmium::Node>())
+            {
+                node_masks.emplace_back(node.id(), 0);
+            }
+            std::sort(node_masks.begin(), node_masks.end());
+            auto find_node = [&](osmium::object_id_type id)
+            {
+                return std::lower_bound(node_masks.begin(), node_masks.end(), std::make_pair(id, std::uint32_t(0)));
+            };
+            for (const osmium::Way& way : buffer.select<osmium::Way>())
+            {
+                std::uint32_t mask = way_masks.at(way.id());
+                for (const osmium::NodeRef& node_ref : way.nodes())
+                {
+                    auto it = find_node(node_ref.ref());
+                    if (it != node_masks.end() && it->first == node_ref.ref())
+                    {
+                        it->second |= mask;
+                    }
+                }
+            }
+
+            // Split the objects into sections by their level masks. Each
+            // section contains its nodes, ways and relations in this order.
+            std::map<std::uint32_t, osmium::memory::Buffer> sections;
+            osmium::Box bounds;
+            for (const osmium::Node& node : buffer.select<osmium::Node>())
+            {
+                std::uint32_t mask = find_node(node.id())->second;
+                osmium::memory::Buffer& nodes = section_buffer(sections, mask != 0 ? mask : ~std::uint32_t(0));
+                nodes.add_item(node);
+                nodes.commit();
+                bounds.extend(node.location());
+                header.nodes++;
+            }
+            for (const osmium::Way& way : buffer.select<osmium::Way>())
+            {
+                osmium::memory::Buffer& ways = section_buffer(sections, way_masks.at(way.id()));
+                ways.add_item(way);
+                ways.commit();
+            }
+            for (const osmium::Relation& relation : buffer.select<osmium::Relation>())
+            {
+                osmium::memory::Buffer& relations = section_buffer(sections, prepared::level_mask(parse_level(relation)));
+                relations.add_item(relation);
+                relations.commit();
+            }
+
+            // Calculate the layout. The sections start after the tables at
+            // the next multiple of the section alignment.
+            header.level_count = counts.size();
+            header.section_count = sections.size();
+            header.bounds[0] = bounds.bottom_left().x();
+            header.bounds[1] = bounds.bottom_left().y();
+            header.bounds[2] = bounds.top_right().x();
+            header.bounds[3] = bounds.top_right().y();
+            std::uint64_t tables_size = sizeof(prepared::PreparedHeader)
+                + counts.size() * sizeof(prepared::PreparedLevel)
+                + sections.size() * sizeof(prepared::PreparedSection);
+            header.data_offset = prepared::align_section(tables_size);
+            std::vector<prepared::PreparedLevel> levels;
+            for (const auto& [level, count] : counts)
+            {
+                prepared::PreparedLevel entry{};
+                entry.level = level;
+                entry.relations = count;
+                levels.push_back(entry);
+            }
+            std::vector<prepared::PreparedSection> entries;
+            std::uint64_t offset = header.data_offset;
+            for (const auto& [mask, section] : sections)
+            {
+                prepared::PreparedSection entry{};
+                entry.mask = mask;
+                entry.offset = offset;
+                entry.size = prepared::align_section(section.committed());
+                offset += entry.size;
+                entries.push_back(entry);
+            }
+            header.data_size = offset - header.data_offset;
+
+            // Write the header, the tables and the sections
+            std::ofstream ofs{ m_path, std::ios::binary | std::ios::trunc };
+            ofs.write(reinterpret_cast<const char*>(&header), sizeof(prepared::PreparedHeader));
+            ofs.write(reinterpret_cast<const char*>(levels.data()), levels.size() * sizeof(prepared::PreparedLevel));
+            ofs.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(prepared::PreparedSection));
+            write_padding(ofs, header.data_offset - tables_size);
+            for (const auto& [mask, section] : sections)
+            {
+                write_section(ofs, section);
+            }
+            ofs.close();
+            if (!ofs)
+            {
+                throw std::runtime_error("Could not write prepared boundary file " + m_path.string());
+            }
+        }
+
+    };
+
+}
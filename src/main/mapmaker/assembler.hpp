@@ -1,12 +1,24 @@
 #pragma once
 
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include <osmium/osm/area.hpp>
 #include <osmium/area/assembler.hpp>
-#include <osmium/area/multipolygon_manager.hpp>
-#include <osmium/handler/node_locations_for_ways.hpp>
-#include <osmium/index/map/flex_mem.hpp>
+#include <osmium/index/id_set.hpp>
+#include <osmium/osm/relation.hpp>
+#include <osmium/osm/way.hpp>
 
 #include "model/types.hpp"
+#include "util/osm.hpp"
+#include "util/parallel.hpp"
 
 namespace mapmaker
 {
@@ -17,15 +29,30 @@ namespace mapmaker
 
         /* Types */
 
-       /**
-        * The type of index used. This must match the include file above
-        */
-        using index_type = osmium::index::map::FlexMem<osmium::unsigned_object_id_type, osmium::Location>;
+        /**
+         * An area to be assembled, which is either a complete boundary
+         * relation or a closed way that is not a member of any boundary
+         * relation. The id is the id of the resulting area.
+         *
+         * The relation and the ways are referenced by their positions among
+         * the relations and ways of the indexed buffer. The member ways of a
+         * relation are stored in the range [first, last) of the member list.
+         */
+        struct Task
+        {
+            osmium::object_id_type id;
+            std::size_t relation;
+            std::size_t way;
+            std::size_t first;
+            std::size_t last;
+        };
+
+        /* Constants */
 
         /**
-         * The location handler always depends on the index type
+         * The position of a missing relation or way in a task.
          */
-        using location_handler_type = osmium::handler::NodeLocationsForWays<index_type>;
+        static constexpr std::size_t NONE = std::numeric_limits<std::size_t>::max();
 
         /* Members */
 
@@ -45,18 +72,66 @@ namespace mapmaker
         std::set<model::level_type> m_levels = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
 
        /**
-        * The split flag. If set to true, the assembled multipolygon areas,
-        * which can contain multiple outer rings are split into polygon areas,
-        * which contain exactly one outer ring (and n inner rings).
+        * The split levels. The assembled multipolygon areas with these
+        * administrative levels, which can contain multiple outer rings are
+        * split into polygon areas, which contain exactly one outer ring
+        * (and n inner rings).
         */
-        bool m_split;
+        std::set<model::level_type> m_split_levels;
+
+        /**
+         * The number of worker threads (0 = auto).
+         */
+        std::size_t m_threads = 1;
+
+        /**
+         * Whether a buffer was indexed.
+         */
+        bool m_indexed = false;
+
+        /**
+         * The areas to be assembled in id order.
+         */
+        std::vector<Task> m_tasks;
+
+        /**
+         * The positions of the member ways of the relation tasks.
+         */
+        std::vector<std::size_t> m_members;
+
+        /**
+         * The number of relations and ways of the indexed buffer.
+         */
+        std::size_t m_relation_count = 0;
+        std::size_t m_way_count = 0;
 
     public:
 
         /* Constructors */
 
         Assembler() {}
-        Assembler(const std::set<model::level_type>& levels, bool split = false) : m_levels(levels), m_split(split) {}
+        Assembler(const std::set<model::level_type>& levels, bool split = false, std::size_t threads = 1)
+        : m_levels(levels), m_threads(threads)
+        {
+            if (split)
+            {
+                m_split_levels = levels;
+            }
+        }
+
+        /**
+         * Creates an assembler that assembles all specified levels in a
+         * single pass and only splits the areas of the split levels.
+         *
+         * @param levels       The levels of the assembled areas
+         * @param split_levels The levels of the areas that are split
+         * @param threads      The number of worker threads (0 = auto)
+         */
+        Assembler(
+            const std::set<model::level_type>& levels,
+            const std::set<model::level_type>& split_levels,
+            std::size_t threads = 1
+        ) : m_levels(levels), m_split_levels(split_levels), m_threads(threads) {}
             
     protected:
 
@@ -100,66 +175,267 @@ namespace mapmaker
 
         }
 
+        /**
+         * Assembles the areas with the osmium area assembler. Since all member
+         * ways are already in the buffer, the boundaries are independent of
+         * each other. The areas are sorted by their id and split into blocks,
+         * which are assembled into separate buffers on the worker threads and
+         * concatenated in order afterwards. Therefore, the areas are always
+         * in id order, regardless of the number of threads.
+         *
+         * @param buffer The buffer, which has to contain the relations and
+         *               ways of the indexed buffer in the same order
+         * @returns      The buffer of assembled areas
+         */
+        osmium::memory::Buffer assemble(const osmium::memory::Buffer& buffer)
+        {
+            osmium::area::Assembler::config_type config;
+
+            // Resolve the positions of the indexed relations and ways
+            std::vector<const osmium::Relation*> relations;
+            for (const osmium::Relation& relation : buffer.select<osmium::Relation>())
+            {
+                relations.push_back(&relation);
+            }
+            std::vector<const osmium::Way*> ways;
+            for (const osmium::Way& way : buffer.select<osmium::Way>())
+            {
+                ways.push_back(&way);
+            }
+            if (relations.size() != m_relation_count || ways.size() != m_way_count)
+            {
+                throw std::invalid_argument("The buffer does not match the indexed buffer of the assembler");
+            }
+
+            // Assemble the blocks of areas into separate buffers
+            std::size_t count = m_tasks.size();
+            std::size_t blocks = std::min(count, 4 * util::thread_count(m_threads));
+            std::vector<osmium::memory::Buffer> buffers(blocks);
+            util::parallel_for(blocks, m_threads, [&](std::size_t block)
+            {
+                osmium::memory::Buffer areas{ 1024, osmium::memory::Buffer::auto_grow::yes };
+                osmium::memory::Buffer copies{ 1024, osmium::memory::Buffer::auto_grow::yes };
+                std::vector<const osmium::Way*> member_ways;
+                for (std::size_t i = block * count / blocks; i < (block + 1) * count / blocks; i++)
+                {
+                    const Task& task = m_tasks[i];
+                    try
+                    {
+                        osmium::area::Assembler assembler{ config };
+                        if (task.way != NONE)
+                        {
+                            assembler(*ways[task.way], areas);
+                            continue;
+                        }
+
+                        // The assembler expects the references of members
+                        // that are not ways to be zero, so it works on a
+                        // copy of the relation
+                        copies.clear();
+                        copies.add_item(*relations[task.relation]);
+                        copies.commit();
+                        osmium::Relation& relation = copies.get<osmium::Relation>(0);
+                        member_ways.clear();
+                        for (std::size_t k = task.first; k < task.last; k++)
+                        {
+                            member_ways.push_back(ways[m_members[k]]);
+                        }
+                        for (osmium::RelationMember& member : relation.members())
+                        {
+                            if (member.type() != osmium::item_type::way)
+                            {
+                                member.set_ref(0);
+                            }
+                        }
+                        assembler(relation, member_ways, areas);
+                    }
+                    catch (const osmium::invalid_location&)
+                    {
+                        // Skip areas with missing node locations
+                        areas.rollback();
+                    }
+                }
+                buffers[block] = std::move(areas);
+            });
+
+            // Concatenate the area buffers in id order
+            std::size_t size = 0;
+            for (const osmium::memory::Buffer& areas : buffers)
+            {
+                size += areas.committed();
+            }
+            osmium::memory::Buffer area_buffer{ std::max(size, std::size_t(1024)), osmium::memory::Buffer::auto_grow::yes };
+            for (const osmium::memory::Buffer& areas : buffers)
+            {
+                area_buffer.add_buffer(areas);
+                area_buffer.commit();
+            }
+            return area_buffer;
+        }
+
+        /**
+         * Checks if an area has one of the split levels.
+         */
+        bool is_split(const osmium::Area& area) const
+        {
+            return std::any_of(m_split_levels.begin(), m_split_levels.end(), [&](model::level_type level)
+            {
+                return area.tags().has_tag("admin_level", std::to_string(level).c_str());
+            });
+        }
+
+        void warn_incomplete(std::size_t count) const
+        {
+            if (count > 0)
+            {
+                std::cerr << "[Warning] Skipped missing members for "
+                          << count
+                          << " boundaries.\n";
+            }
+        }
+
     public:
 
         /* Methods */
 
-        void run(osmium::memory::Buffer& buffer)
+        /**
+         * Determines the areas to be assembled from the relations and ways of
+         * a buffer. The relations and closed ways are selected with the same
+         * checks as in the reader. Closed ways that are members of an
+         * assembled boundary relation are only assembled as part of the
+         * relation.
+         *
+         * The tasks reference the relations and ways by their positions, so
+         * the index is reused by run() for every buffer with the same
+         * relations and ways in the same order, such as the compressed
+         * copies of the indexed buffer.
+         *
+         * @param buffer The buffer with the ways and relations
+         */
+        void index(const osmium::memory::Buffer& buffer)
         {
-            // Create the default configuration for the osmium assembler.
-            osmium::area::Assembler::config_type config;
+            osmium::TagsFilter filter = util::level_filter(m_levels);
+            m_tasks.clear();
+            m_members.clear();
 
-            // Prepare the tag filter for the multipolygon manager with the
-            // specified administrative levels.
-            osmium::TagsFilter filter{ false };
-            for (const model::level_type& level : m_levels)
+            // Index the ways by their id
+            std::vector<std::pair<osmium::object_id_type, std::size_t>> ways;
+            for (const osmium::Way& way : buffer.select<osmium::Way>())
             {
-                filter.add_rule(true, "admin_level", std::to_string(level));
+                ways.emplace_back(way.id(), ways.size());
             }
+            m_way_count = ways.size();
+            std::sort(ways.begin(), ways.end());
+            auto find_way = [&](osmium::object_id_type id) -> std::size_t
+            {
+                auto it = std::lower_bound(ways.begin(), ways.end(), std::make_pair(id, std::size_t(0)));
+                return it != ways.end() && it->first == id ? it->second : NONE;
+            };
 
-            // Initialize the MultipolygonManager. Its job is to collect all
-            // relations and member ways needed for each area. It then calls an
-            // instance of the osmium::area::Assembler class (with the given config)
-            // to actually assemble one area.
-            osmium::area::MultipolygonManager<osmium::area::Assembler> mp_manager{ config, filter };
-
-            // First pass through the buffer: The manager will read all relation
-            // and filter out any relations that do not match the filter.
-            osmium::apply(buffer, mp_manager);
-            mp_manager.prepare_for_lookup();
-
-            // The index storing all node locations.
-            index_type index;
-
-            // The handler that stores all node locations in the index and adds them
-            // to the ways.
-            osmium::handler::NodeLocationsForWays<index_type> location_handler{ index };
-            location_handler.ignore_errors();
-
-            // Second pass through the buffer: Assemble the filtered boundary
-            // relations into areas.
-            osmium::apply(buffer, location_handler, mp_manager.handler());
-            osmium::memory::Buffer area_buffer = mp_manager.read();
-
-            // If there were boundary relations in the input with members that
-            //  weren't part of the input file (which often happens for extracts),
-            // write the IDs of the incomplete relations to stderr.
-            std::vector<osmium::object_id_type> incomplete_relations_ids;
-            mp_manager.for_each_incomplete_relation([&](const osmium::relations::RelationHandle& handle) {
-                incomplete_relations_ids.push_back(handle->id());
+            // Collect the boundary relations, whose member ways are all
+            // available, and mark their member ways. Only the members of
+            // assembled relations are marked, so that the closed ways of
+            // skipped relations are still assembled on their own.
+            osmium::index::IdSetDense<osmium::unsigned_object_id_type> members;
+            std::size_t incomplete = 0;
+            std::size_t position = 0;
+            for (const osmium::Relation& relation : buffer.select<osmium::Relation>())
+            {
+                std::size_t current = position++;
+                if (!util::is_boundary(relation, filter))
+                {
+                    continue;
+                }
+                bool complete = std::all_of(relation.members().cbegin(), relation.members().cend(), [&](const osmium::RelationMember& member)
+                {
+                    return member.type() != osmium::item_type::way || find_way(member.ref()) != NONE;
+                });
+                if (!complete)
+                {
+                    incomplete++;
+                    continue;
+                }
+                std::size_t first = m_members.size();
+                for (const osmium::RelationMember& member : relation.members())
+                {
+                    if (member.type() == osmium::item_type::way)
+                    {
+                        members.set(member.positive_ref());
+                        m_members.push_back(find_way(member.ref()));
+                    }
+                }
+                m_tasks.push_back(Task{
+                    osmium::object_id_to_area_id(relation.id(), osmium::item_type::relation),
+                    current,
+                    NONE,
+                    first,
+                    m_members.size()
                 });
-            if (!incomplete_relations_ids.empty())
+            }
+            m_relation_count = position;
+            warn_incomplete(incomplete);
+
+            // Closed ways that are not part of any boundary are areas too
+            position = 0;
+            for (const osmium::Way& way : buffer.select<osmium::Way>())
             {
-                std::cerr << "[Warning] Skipped missing members for "
-                          << incomplete_relations_ids.size()
-                          << " boundaries.\n";
+                std::size_t current = position++;
+                if (!members.get(way.positive_id()) && util::is_area_way(way, filter))
+                {
+                    m_tasks.push_back(Task{
+                        osmium::object_id_to_area_id(way.id(), osmium::item_type::way),
+                        NONE,
+                        current,
+                        0,
+                        0
+                    });
+                }
             }
-      
-            // Add the assembled areas from the area buffer to the input buffer
+            std::sort(m_tasks.begin(), m_tasks.end(), [](const Task& t1, const Task& t2)
+            {
+                return t1.id < t2.id;
+            });
+            m_indexed = true;
+        }
+
+        /**
+         * Assembles the boundary areas of the nodes, ways and relations in
+         * the buffer. The areas are stored in a separate buffer, so that the
+         * input buffer can be freed afterwards and later stages only have
+         * to iterate the areas.
+         *
+         * The buffer is indexed first, unless another buffer was indexed
+         * before. In this case, the buffer has to contain the same relations
+         * and ways in the same order.
+         *
+         * @param buffer The buffer with the located ways and relations
+         * @returns      The buffer with the assembled areas only
+         */
+        osmium::memory::Buffer run(const osmium::memory::Buffer& buffer)
+        {
+            if (!m_indexed)
+            {
+                index(buffer);
+            }
+
+            // Assemble the boundary areas in id order, so that the ids of the
+            // split areas do not depend on the number of threads
+            osmium::memory::Buffer area_buffer = assemble(buffer);
+            if (m_split_levels.empty())
+            {
+                return area_buffer;
+            }
+
+            // Split the areas of the split levels into a result buffer,
+            // which has about the same size as the area buffer
+            osmium::memory::Buffer result{
+                std::max(area_buffer.committed(), std::size_t(1024)),
+                osmium::memory::Buffer::auto_grow::yes
+            };
             std::size_t offset = 0;
             for (const osmium::Area& area : area_buffer.select<osmium::Area>())
             {
-                if (m_split)
+                if (is_split(area))
                 {
                     // Retrieve the area name
                     std::string name = area.get_value_by_key("name", "");
@@ -169,8 +445,8 @@ namespace mapmaker
                     }
                     if (area.outer_rings().size() == 1)
                     {
-                        create_area_from_ring(buffer, area, *area.outer_rings().begin(), area.id() * (offset + 1), name);
-                        buffer.commit();
+                        create_area_from_ring(result, area, *area.outer_rings().begin(), area.id() * (offset + 1), name);
+                        result.commit();
                         ++offset;
                     }
                     else
@@ -179,8 +455,8 @@ namespace mapmaker
                         std::size_t i = 1;
                         for (const osmium::OuterRing& outer : area.outer_rings())
                         {
-                            create_area_from_ring(buffer, area, outer, area.id() * (offset + 1), name + ' ' + std::to_string(i));
-                            buffer.commit();
+                            create_area_from_ring(result, area, outer, area.id() * (offset + 1), name + ' ' + std::to_string(i));
+                            result.commit();
                             ++i;
                             ++offset;
                         }
@@ -188,10 +464,11 @@ namespace mapmaker
                 }
                 else
                 {
-                    buffer.add_item(area);
-                    buffer.commit();
+                    result.add_item(area);
+                    result.commit();
                 }
             }
+            return result;
         }
 
     };
@@ -23,7 +23,7 @@ namespace mapmaker
         level_type m_bonus_level       = 0;
         level_type m_super_bonus_level = 0;
 
-        graph::UndirectedGraph m_neighbors = {};
+        graph::CompressedGraph m_neighbors = {};
 
         std::map<object_id_type, std::set<object_id_type>> m_hierarchy = {};
 
@@ -67,7 +67,7 @@ namespace mapmaker
             m_super_bonus_level = level;
         }
 
-        void neighbors(const graph::UndirectedGraph& neighbors)
+        void neighbors(const graph::CompressedGraph& neighbors)
         {
             m_neighbors = neighbors;
         }
@@ -124,9 +124,13 @@ namespace mapmaker
                 boundary.center
             };
             // Add the neighbors
-            for (const object_id_type& neighbor : m_neighbors.adjacents(boundary.id))
+            graph::CompressedGraph::index_type index = m_neighbors.find(boundary.id);
+            if (index != graph::CompressedGraph::npos)
             {
-                territory.neighbors.push_back(m_ids.at(neighbor));
+                for (graph::CompressedGraph::index_type neighbor : m_neighbors.adjacents(index))
+                {
+                    territory.neighbors.push_back(m_ids.at(m_neighbors.vertex(neighbor)));
+                }
             }
             return territory;
         }
@@ -179,7 +183,7 @@ namespace mapmaker
 
         /* Methods */
 
-        warzone::Map<T> run(std::map<object_id_type, Boundary<T>>& boundaries)
+        warzone::Map<T> run(BoundaryMap<T>& boundaries)
         {
             // Create the total set of levels
             std::set<level_type> levels{ m_territory_level };
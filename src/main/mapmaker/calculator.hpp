@@ -1,11 +1,20 @@
 #pragma once
 
+#include <cmath>
+
 #include "model/geometry/point.hpp"
 #include "model/geometry/rectangle.hpp"
+#include "model/geometry/polygon.hpp"
+#include "model/geometry/multipolygon.hpp"
 
 #include "handler/bounds_handler.hpp"
 
+#include "functions/area.hpp"
 #include "functions/center.hpp"
+#include "functions/envelope.hpp"
+#include "functions/intersect.hpp"
+#include "functions/prepared.hpp"
+#include "functions/detail/polylabel.hpp"
 
 using namespace model;
 
@@ -26,7 +35,7 @@ namespace mapmaker
         geometry::Rectangle<T> run(const osmium::memory::Buffer& buffer) const
         {
             // Prepare the bounds handler that calculates the minimum bounding
-            // box over all nodes in the buffer
+            // box over all nodes and areas in the buffer
             handler::BoundsHandler bounds_handler{};
             osmium::apply(buffer, bounds_handler);
             // Retrieve the calculated bounds and convert them to a rectangle
@@ -45,19 +54,98 @@ namespace mapmaker
     template <typename T>
     class CenterCalculator
     {
+    protected:
+
+        /* Members */
+
+        /**
+         * Whether the pole of inaccessibility is used for boundaries whose
+         * centroid lies outside of them. Otherwise, the centroid is always
+         * used.
+         */
+        bool m_polylabel = false;
+
+        /**
+         * The precision of the pole of inaccessibility in map coordinates.
+         */
+        double m_precision = 1.0;
+
     public:
 
         /* Constructors */
 
         CenterCalculator() {}
+        CenterCalculator(bool polylabel, double precision = 1.0) : m_polylabel(polylabel), m_precision(precision) {}
+
+    protected:
+
+        /* Helper Methods */
+
+        /**
+         * Checks if a point lies strictly inside of a polygon. The rings are
+         * only tested once, so that they are not prepared.
+         */
+        static bool contains(const geometry::Polygon<T>& polygon, const geometry::Point<T>& point)
+        {
+            if (functions::point_in_ring(point, polygon.outer()) <= 0)
+            {
+                return false;
+            }
+            for (const geometry::Ring<T>& inner : polygon.inners())
+            {
+                if (functions::point_in_ring(point, inner) >= 0)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * Calculates the center of a multipolygon. The weighted centroid is
+         * a good center for most boundaries, but it may lie outside of
+         * concave boundaries. In that case, the pole of inaccessibility of
+         * the largest polygon is used instead if enabled.
+         */
+        geometry::Point<T> center(const geometry::MultiPolygon<T>& multipolygon) const
+        {
+            geometry::Point<T> centroid = functions::center(multipolygon);
+            if (!m_polylabel)
+            {
+                return centroid;
+            }
+            const geometry::Polygon<T>* largest = nullptr;
+            double largest_area = 0.0;
+            for (const geometry::Polygon<T>& polygon : multipolygon.polygons())
+            {
+                if (functions::point_in_rectangle(centroid, functions::envelope(polygon)) && contains(polygon, centroid))
+                {
+                    return centroid;
+                }
+                double area = std::abs(functions::area(polygon));
+                if (largest == nullptr || area > largest_area)
+                {
+                    largest = &polygon;
+                    largest_area = area;
+                }
+            }
+            if (largest == nullptr)
+            {
+                return centroid;
+            }
+            functions::PreparedPolygon<T> prepared{ *largest };
+            return functions::detail::polylabel(prepared, functions::center(*largest), m_precision).first;
+        }
+
+    public:
 
         /* Methods */
 
-        void run(std::map<object_id_type, Boundary<T>>& boundaries)
+        void run(BoundaryMap<T>& boundaries)
         {
             for (auto& [id, boundary] : boundaries)
             {
-                boundary.center = functions::center(boundary.geometry);
+                boundary.center = center(boundary.geometry);
             }
         }
 
@@ -1,121 +1,147 @@
 #pragma once
 
-#include <map>
-#include <set>
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <vector>
 
 #include <osmium/builder/osm_object_builder.hpp>
-#include <osmium/handler/node_locations_for_ways.hpp>
-#include <osmium/index/map/flex_mem.hpp>
+#include <osmium/index/id_set.hpp>
 #include <osmium/osm/types.hpp>
 
 #include "handler/compression_handler.hpp"
+#include "mapmaker/topology.hpp"
+#include "model/topology.hpp"
+#include "util/parallel.hpp"
 
 namespace mapmaker
 {
 
+    /**
+     * A class for compressing the ways of a buffer with the Douglas-Peucker
+     * algorithm. The ways are split into arcs between junction nodes once,
+     * so that the arcs are shared by all compression tolerances.
+     */
     class Compressor
     {
     protected:
 
         /* Types */
 
-       /**
-        * The type of index used. This must match the include file above
-        */
-        using index_type = osmium::index::map::FlexMem<osmium::unsigned_object_id_type, osmium::Location>;
-
         /**
-         * The location handler always depends on the index type
+         * The node id set type.
          */
-        using location_handler_type = osmium::handler::NodeLocationsForWays<index_type>;
+        using id_set_type = handler::CompressionHandler::id_set_type;
 
         /* Members */
 
-        double m_tolerance;
+        /**
+         * The buffer with the located ways, which is never changed.
+         */
+        const osmium::memory::Buffer& m_buffer;
+
+        /**
+         * The number of worker threads (0 = auto).
+         */
+        std::size_t m_threads;
+
+        /**
+         * The topology of the ways, which is built on the first compression.
+         */
+        std::optional<model::Topology> m_topology;
+
+        /* Helper Methods */
+
+        /**
+         * Splits the ways into arcs between junction nodes. Junctions are
+         * never removed in order to avoid the creation of holes between
+         * boundaries. Each arc is compressed only once, even if it is shared
+         * by multiple ways. The node references of the ways are already
+         * located by the reader.
+         */
+        const model::Topology& topology()
+        {
+            if (!m_topology)
+            {
+                TopologyBuilder builder;
+                for (const osmium::Way& way : m_buffer.select<osmium::Way>())
+                {
+                    builder.add(way.id(), way.nodes());
+                }
+                m_topology = builder.build();
+            }
+            return *m_topology;
+        }
 
     public:
 
         /* Constructors */
 
         /**
-         * Run the compressor on the way and node buffers.
-         * Nodes and ways that were removed by the compression will be
-         * removed in the respective buffers.
+         * Creates a compressor for the ways of a buffer. The buffer is
+         * referenced, so it has to outlive the compressor.
+         *
+         * @param buffer  The buffer with the located ways
+         * @param threads The number of worker threads (0 = auto).
+         */
+        Compressor(const osmium::memory::Buffer& buffer, std::size_t threads = 1)
+        : m_buffer(buffer), m_threads(threads) {}
+
+        /* Methods */
+
+        /**
+         * Compresses the ways with a tolerance and creates a new buffer
+         * without the removed nodes. The other objects are copied in their
+         * original order, so the ways and relations of the result are in
+         * the same order as in the input buffer.
          *
          * For more information on finding a good tolerance value, refer
          * to https://en.wikipedia.org/wiki/Ramer%E2%80%93Douglas%E2%80%93Peucker_algorithm
          *
          * @param tolerance The distance epsilon for the Douglas-Peucker-Algorithm.
+         *                  It has to be greater than zero.
+         * @returns         The compressed buffer
          *
          * Time complexity: Log-Linear (Average-case), Quadratic (Worst-case)
          */
-        Compressor(double tolerance) : m_tolerance(tolerance) {}
-            
-        /* Methods */
-
-        void run(osmium::memory::Buffer& buffer)
+        osmium::memory::Buffer run(double tolerance)
         {
-            // If the tolerance is less or equal to zero,
-            // no compression will be applied.
-            if (m_tolerance <= 0)
-            {
-                return;
-            }
-
-            // Calculate the degrees for each node in the input buffer. The
-            // resulting map will indicate which nodes should be ignored during
-            // the compression process in order to avoid the creation of holes
-            // between boundaries.
-            std::map<osmium::object_id_type, std::size_t> node_degrees{};
-            for (const osmium::Way& way : buffer.select<osmium::Way>())
+            const model::Topology& topology = this->topology();
+
+            // Compress the arcs using the Douglas-Peucker algorithm and
+            // retrieve the set of removed node ids. The inner nodes of
+            // different arcs are disjoint, so the arcs are compressed in
+            // parallel blocks with a handler for each block.
+            std::size_t count = topology.arc_count();
+            std::size_t blocks = std::min(count, 4 * util::thread_count(m_threads));
+            std::vector<std::unique_ptr<handler::CompressionHandler>> handlers(blocks);
+            util::parallel_for(blocks, m_threads, [&](std::size_t block)
             {
-                for (const osmium::NodeRef& nr : way.nodes())
+                handlers[block] = std::make_unique<handler::CompressionHandler>(tolerance, topology.junctions());
+                for (std::size_t i = block * count / blocks; i < (block + 1) * count / blocks; i++)
                 {
-                    // Check if node entry exists in the count map
-                    auto it = node_degrees.find(nr.ref());
-                    if (it == node_degrees.end())
-                    {
-                        it = node_degrees.insert(it, { nr.ref(), 0 });
-                    }
-                    it->second += 1;
+                    handlers[block]->compress(topology.arc(i));
                 }
-            }
-
-            // Ignore nodes that have more than two neighbors.
-            std::set<osmium::object_id_type> ignored_nodes;
-            for (const auto& [id, degree] : node_degrees)
+            });
+            handler::CompressionHandler compression_handler{ tolerance, topology.junctions() };
+            for (const auto& block_handler : handlers)
             {
-                if (degree > 2)
-                {
-                    ignored_nodes.insert(id);
-                }
+                compression_handler.merge(*block_handler);
             }
+            const id_set_type& removed_nodes = compression_handler.removed_nodes();
 
-            // The index storing all node locations.
-            index_type index;
-
-            // The handler that stores all node locations in the index and adds them
-            // to the ways.
-            osmium::handler::NodeLocationsForWays<index_type> location_handler{ index };
-            location_handler.ignore_errors();
-
-            // Compress the ways in the buffer using the Douglas-Peucker
-            // algorithm and retrieve the set of removed node ids.
-            handler::CompressionHandler compression_handler{ m_tolerance, ignored_nodes };
-            osmium::apply(buffer, location_handler, compression_handler);
-            std::set<osmium::object_id_type> removed_nodes = compression_handler.removed_nodes();
-
-            // Create a new buffer by copying the objects from the old buffer
+            // Create a new buffer by copying the objects from the input buffer
             // while ignoring nodes that were marked as removed by the
-            // compression handler.
-            osmium::memory::Buffer result{ 1024, osmium::memory::Buffer::auto_grow::yes };
-            for (const auto& object : buffer.select<osmium::OSMObject>())
+            // compression handler. The result is never larger than the input
+            // buffer, so it is allocated once with the size of the input.
+            osmium::memory::Buffer result{ std::max(m_buffer.committed(), std::size_t(1024)), osmium::memory::Buffer::auto_grow::yes };
+            for (const auto& object : m_buffer.select<osmium::OSMObject>())
             {
                 switch (object.type())
                 {
                 case osmium::item_type::node:
                     // Copy the node if it was not marked as removed
-                    if (!removed_nodes.count(object.id()))
+                    if (!removed_nodes.get(object.positive_id()))
                     {
                         result.add_item(object);
                         result.commit();
@@ -142,9 +168,9 @@ namespace mapmaker
                             osmium::builder::WayNodeListBuilder way_nodes_builder{ way_builder };
                             for (const osmium::NodeRef& nr : way.nodes())
                             {
-                                if (!removed_nodes.count(nr.ref()))
+                                if (!removed_nodes.get(nr.positive_ref()))
                                 {
-                                    way_nodes_builder.add_node_ref(nr.ref());
+                                    way_nodes_builder.add_node_ref(nr);
                                 }
                             }
                         }
@@ -157,8 +183,7 @@ namespace mapmaker
                 }
             }
 
-            // Swap the old buffer with the resulting compressed buffer
-            std::swap(buffer, result);
+            return result;
         }
 
     };
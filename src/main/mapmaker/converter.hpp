@@ -1,51 +1,77 @@
 #pragma once
 
-#include <map>
+#include <cstddef>
 #include <vector>
 
 #include <osmium/memory/buffer.hpp>
+#include <osmium/osm/area.hpp>
 
 #include "model/boundary.hpp"
 #include "handler/convert_handler.hpp"
+#include "util/parallel.hpp"
 
 using namespace model;
 
 namespace mapmaker
 {
 
-	template <typename T>
-	class BoundaryConverter
-	{
+    /**
+     * A converter that transforms the areas of a buffer with a composed
+     * transformation and converts them to boundaries.
+     *
+     * The areas are converted on several threads. Each boundary is written
+     * to the position of its area in a presized vector, so that the threads
+     * do not have to synchronize.
+     */
+    template <typename T, typename Transformation>
+    class BoundaryConverter
+    {
     protected:
 
-        /* Types */
-
-       /**
-        * The abstract transformation type.
-        */
-        using Transformation = std::shared_ptr<functions::Transformation<T>>;
-
         /* Members */
 
-        std::vector<Transformation> m_transformations;
+        Transformation m_transformation;
 
-	public:
+        /**
+         * The number of worker threads (0 = auto).
+         */
+        std::size_t m_threads;
+
+    public:
 
         /* Constructors */
 
-		BoundaryConverter() {}
-        BoundaryConverter(Transformation transformation) : m_transformations({ transformation }) {}
-        BoundaryConverter(std::initializer_list<Transformation> transformations) : m_transformations(transformations) {}
+        BoundaryConverter(const Transformation& transformation, std::size_t threads = 0)
+        : m_transformation(transformation), m_threads(threads) {}
 
         /* Methods */
 
-		std::map<model::object_id_type, model::Boundary<T>> run(const osmium::memory::Buffer& buffer)
-		{
-            handler::BoundaryConvertHandler<T> convert_handler{ m_transformations };
-            osmium::apply(buffer, convert_handler);
-            return convert_handler.boundaries();
-		}
-
-	};
+        model::BoundaryMap<T> run(const osmium::memory::Buffer& buffer)
+        {
+            // Collect the areas, so that each area has a dense index
+            std::vector<const osmium::Area*> areas;
+            for (const osmium::Area& area : buffer.select<osmium::Area>())
+            {
+                areas.push_back(&area);
+            }
+
+            // Convert the areas on the worker threads. The areas differ a lot
+            // in size, so that they are fetched one by one instead of in fixed
+            // blocks. Each call uses its own handler, which only copies the
+            // transformation parameters.
+            std::vector<typename model::BoundaryMap<T>::value_type> boundaries(areas.size());
+            util::parallel_for(areas.size(), m_threads, [&](std::size_t i)
+            {
+                handler::BoundaryConvertHandler<T, Transformation> convert_handler{ m_transformation };
+                boundaries[i].first = areas[i]->id();
+                boundaries[i].second = convert_handler.convert(*areas[i]);
+            });
+
+            // The lookup only sorts the boundaries if the areas were not
+            // already ordered by their ids
+            return model::BoundaryMap<T>{ std::move(boundaries) };
+        }
+
+    };
 
 }
\ No newline at end of file
@@ -1,14 +1,19 @@
 #pragma once
 
+#include <algorithm>
+#include <map>
 #include <numeric>
+#include <set>
+#include <vector>
 
-#include <osmium/osm/node.hpp>
+#include <osmium/builder/osm_object_builder.hpp>
+#include <osmium/index/id_set.hpp>
+#include <osmium/memory/buffer.hpp>
 #include <osmium/osm/area.hpp>
 
-#include "model/graph/undirected_graph.hpp"
+#include "model/graph/components.hpp"
 
 #include "handler/calculation_handler.hpp"
-#include "handler/filter_handler.hpp"
 
 using namespace model;
 
@@ -17,173 +22,250 @@ namespace mapmaker
         
     /**
      * A filter that removes areas based on their surface area.
+     *
+     * The filter is created for an area buffer, whose surface areas are
+     * calculated once. It does not modify the area buffer, but returns the
+     * ids of the removed areas and rebuilds the remaining areas that lose
+     * some of their rings into a separate buffer, so that the filter can be
+     * applied on the area buffer with several tolerances.
      */
     class AreaFilter
     {
     protected:
 
+        /* Types */
+
+        using id_set_type = osmium::index::IdSetDense<osmium::unsigned_object_id_type>;
+
         /* Members */
 
+        /**
+         * The area buffer, which has to outlive the filter.
+         */
+        const osmium::memory::Buffer& m_buffer;
+
         double m_tolerance;
+
+        /**
+         * The surface areas of the areas in the buffer.
+         */
+        std::map<osmium::object_id_type, double> m_surfaces;
+
+        /**
+         * The areas of the last run that lost some of their rings.
+         */
+        osmium::memory::Buffer m_rebuilt{ 1024, osmium::memory::Buffer::auto_grow::yes };
             
     public:
 
         /* Constructors */
 
-        AreaFilter(double tolerance) : m_tolerance(tolerance) {}
+        AreaFilter(const osmium::memory::Buffer& buffer, double tolerance = 0.0)
+        : m_buffer(buffer), m_tolerance(tolerance)
+        {
+            // Calculate the surface areas of each area in the buffer once
+            handler::SurfaceAreaHandler surface_handler{};
+            osmium::apply(m_buffer, surface_handler);
+            m_surfaces = surface_handler.surfaces();
+        }
+
+        /* Setters */
+
+        void tolerance(double tolerance)
+        {
+            m_tolerance = tolerance;
+        }
+
+        /* Accessors */
+
+        /**
+         * Returns the rebuilt areas of the last run. They replace the areas
+         * with the same ids in the area buffer.
+         */
+        const osmium::memory::Buffer& rebuilt() const
+        {
+            return m_rebuilt;
+        }
+
+    protected:
+
+        /* Helper Methods */
+
+        /**
+         * Checks if a ring runs through a removed node. The ways of the ring
+         * that contain the node are removed along with the node, so that the
+         * ring cannot be closed anymore.
+         */
+        static bool is_removed(const osmium::NodeRefList& ring, const id_set_type& removed_nodes)
+        {
+            return std::any_of(ring.begin(), ring.end(), [&](const osmium::NodeRef& node_ref)
+            {
+                return removed_nodes.get(node_ref.positive_ref());
+            });
+        }
+
+        /**
+         * Checks if an area loses any of its rings.
+         */
+        static bool is_modified(const osmium::Area& area, const id_set_type& removed_nodes)
+        {
+            auto outer_rings = area.outer_rings();
+            auto inner_rings = area.subitems<const osmium::InnerRing>();
+            auto ring_removed = [&](const osmium::NodeRefList& ring) { return is_removed(ring, removed_nodes); };
+            return std::any_of(outer_rings.begin(), outer_rings.end(), ring_removed)
+                || std::any_of(inner_rings.begin(), inner_rings.end(), ring_removed);
+        }
+
+        /**
+         * Rebuilds an area without the removed rings. The inner rings of
+         * removed outer rings are removed as well.
+         *
+         * @returns False if no outer ring remains and the area was not
+         *          rebuilt
+         */
+        static bool rebuild_area(
+            osmium::memory::Buffer& buffer,
+            const osmium::Area& area,
+            const id_set_type& removed_nodes
+        ) {
+            bool empty = std::all_of(area.outer_rings().begin(), area.outer_rings().end(),
+                [&](const osmium::OuterRing& outer) { return is_removed(outer, removed_nodes); }
+            );
+            if (empty)
+            {
+                return false;
+            }
+            {
+                osmium::builder::AreaBuilder area_builder{ buffer };
+
+                // Copy the area attributes and tags
+                area_builder.set_id(area.id())
+                    .set_version(area.version())
+                    .set_changeset(area.changeset())
+                    .set_timestamp(area.timestamp())
+                    .set_uid(area.uid())
+                    .set_user(area.user())
+                    .add_item(area.tags());
+
+                // Copy the remaining outer rings and their inner rings
+                for (const osmium::OuterRing& outer : area.outer_rings())
+                {
+                    if (is_removed(outer, removed_nodes))
+                    {
+                        continue;
+                    }
+                    area_builder.add_item(outer);
+                    for (const osmium::InnerRing& inner : area.inner_rings(outer))
+                    {
+                        if (!is_removed(inner, removed_nodes))
+                        {
+                            area_builder.add_item(inner);
+                        }
+                    }
+                }
+            }
+            buffer.commit();
+            return true;
+        }
+
+    public:
                 
         /* Methods */
 
         /**
-         * Apply the filter on the specified area buffer.
-         * Areas that have a smaller surface area relative to the
+         * Apply the filter on the area buffer, which contains the assembled
+         * areas only.
+         * Components that have a smaller surface area relative to the
          * total surface area than the specified threshold will be
          * removed.
          *
+         * Since a component has no neighbors outside of itself, the neighbor
+         * graph stays valid for the remaining areas. The remaining areas of
+         * other levels lose the rings that run through a node of a removed
+         * area, as if they were assembled again from the ways that do not
+         * contain such a node. They are rebuilt into the buffer of rebuilt
+         * areas. Areas that lose all of their outer rings are removed as
+         * well.
+         *
+         * @param components The connected components of the territories
+         * @returns          The ids of the removed areas
          *
          * Time complexity: Linear
          */
-        void run(
-            osmium::memory::Buffer& buffer,
-            graph::UndirectedGraph& neighbors,
-            std::vector<std::set<osmium::object_id_type>>& components
-        ){
-            // Calculate the surface areas of each area in the buffer.
-            handler::SurfaceAreaHandler surface_handler{};
-            osmium::apply(buffer, surface_handler);
-            std::map<osmium::object_id_type, double> area_surfaces = surface_handler.surfaces();
-            double total_surface = surface_handler.total();
+        std::set<osmium::object_id_type> run(const graph::Components& components)
+        {
+            m_rebuilt.clear();
 
-            // Filter components by checking if their relative surface area is
-            // less than the specified threshold
-            std::set<osmium::object_id_type> removed_areas{};
-            for (std::size_t i = 0; i < components.size();)
+            // Calculate the surface area of each component. The buffer may
+            // contain areas of other levels, which are not part of any
+            // component. Therefore, the total surface area is the sum of the
+            // component areas.
+            std::vector<double> component_surfaces(components.size(), 0.0);
+            for (std::size_t i = 0; i < components.size(); i++)
             {
-                // Calculate the component surface area
-                double component_surface = 0;
-                for (const osmium::object_id_type& id : components.at(i))
+                for (const osmium::object_id_type& id : components[i])
                 {
-                    component_surface += area_surfaces.at(id);
+                    component_surfaces[i] += m_surfaces.at(id);
                 }
+            }
+            double total_surface = std::accumulate(component_surfaces.begin(), component_surfaces.end(), 0.0);
 
-                double relative_surface = component_surface / total_surface;
+            // Filter components by checking if their relative surface area is
+            // less than the specified threshold
+            std::set<osmium::object_id_type> removed_areas{};
+            for (std::size_t i = 0; i < components.size(); i++)
+            {
+                double relative_surface = component_surfaces[i] / total_surface;
                 if (relative_surface < m_tolerance)
                 {
-                    // Mark all areas in the component for removal
-                    for (const osmium::object_id_type& id : components.at(i))
-                    {
-                        removed_areas.insert(id);
-                    }
-                    components.erase(components.begin() + i);
-                }
-                else
-                {
-                    i++;
+                    removed_areas.insert(components[i].begin(), components[i].end());
                 }
             }
 
-            // Check if any areas were marked for removal before continuing
+            // Check if any areas were removed before continuing
             if (removed_areas.empty())
             {
-                return;
+                return removed_areas;
             }
-            
-            // Retrieve the node references for the removed areas
-            handler::AreaNodeFilterHandler node_handler{ removed_areas };
-            osmium::apply(buffer, node_handler);
-            std::set<osmium::object_id_type> removed_nodes = node_handler.references();
-
-            // Retrieve the way references for the removed areas
-            handler::NodeWayFilterHandler way_handler{ removed_nodes };
-            osmium::apply(buffer, way_handler);
-            std::set<osmium::object_id_type> removed_ways = way_handler.references();
-
-            // Remove the marked areas and their associated nodes and ways from
-            // the buffer
-            osmium::memory::Buffer result{ 1024, osmium::memory::Buffer::auto_grow::yes };
-            for (const auto& object : buffer.select<osmium::OSMObject>())
+
+            // Collect the nodes of the removed areas
+            id_set_type removed_nodes;
+            for (const osmium::Area& area : m_buffer.select<osmium::Area>())
             {
-                switch (object.type())
+                if (removed_areas.count(area.id()))
                 {
-                case osmium::item_type::node:
-                    if (!removed_nodes.count(object.id()))
+                    for (const osmium::OuterRing& outer : area.outer_rings())
                     {
-                        result.add_item(object);
-                        result.commit();
-                    }
-                    break;
-                case osmium::item_type::way:
-                    if (!removed_ways.count(object.id()))
-                    {
-                        if (!removed_areas.count(osmium::object_id_to_area_id(object.id(), object.type())))
+                        for (const osmium::NodeRef& node_ref : outer)
                         {
-                            result.add_item(object);
-                            result.commit();
+                            removed_nodes.set(node_ref.positive_ref());
                         }
-                    }
-                    break;
-                case osmium::item_type::relation:
-                    if (!removed_areas.count(osmium::object_id_to_area_id(object.id(), object.type())))
-                    {
+                        for (const osmium::InnerRing& inner : area.inner_rings(outer))
                         {
-                            // Rebuild relation without the removed way members
-                            osmium::builder::RelationBuilder relation_builder{ result };
-
-                            // Copy the way attributes and tags
-                            relation_builder.set_id(object.id())
-                                .set_version(object.version())
-                                .set_changeset(object.changeset())
-                                .set_timestamp(object.timestamp())
-                                .set_uid(object.uid())
-                                .set_user(object.user())
-                                .add_item(object.tags());
-
+                            for (const osmium::NodeRef& node_ref : inner)
                             {
-                                // Copy the relation references and filter the removed ways
-                                const osmium::Relation& relation = static_cast<const osmium::Relation&>(object);
-                                osmium::builder::RelationMemberListBuilder members_builder{ relation_builder };
-                                for (const osmium::RelationMember& member : relation.members())
-                                {
-                                    if (member.type() != osmium::item_type::way || !removed_ways.count(member.ref()))
-                                    {
-                                        members_builder.add_member(member.type(), member.ref(), member.role());
-                                    }
-                                }
+                                removed_nodes.set(node_ref.positive_ref());
                             }
                         }
-                        result.commit();
                     }
-                    break;
-                case osmium::item_type::area:
-                    if (!removed_areas.count(object.id()))
-                    {
-                        result.add_item(object);
-                        result.commit();
-                    }
-                    break;
                 }
             }
-            std::swap(buffer, result);
 
-            // Remove the marked areas and their neighbors from the neighbor
-            // graph by creating a filtered copy.
-            graph::UndirectedGraph result_neighbors{};
-            for (const graph::vertex_type& vertex : neighbors.vertices())
+            // Rebuild the remaining areas that lose some of their rings into
+            // the separate buffer, as items cannot shrink in place. Areas
+            // without remaining outer rings are removed.
+            for (const osmium::Area& area : m_buffer.select<osmium::Area>())
             {
-                if (!removed_areas.count(vertex))
+                if (removed_areas.count(area.id()))
                 {
-                    result_neighbors.insert_vertex(vertex);
+                    continue;
                 }
-            }
-            for (const graph::edge_type& edge : neighbors.edges())
-            {
-                if (!removed_areas.count(edge.first) && !removed_areas.count(edge.second))
+                if (is_modified(area, removed_nodes) && !rebuild_area(m_rebuilt, area, removed_nodes))
                 {
-                    result_neighbors.insert_edge(edge);
+                    removed_areas.insert(area.id());
                 }
             }
-            std::swap(neighbors, result_neighbors);
-
+            return removed_areas;
         }
 
     };
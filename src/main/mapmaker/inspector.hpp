@@ -1,11 +1,30 @@
 #pragma once
 
+#include <algorithm>
+#include <iterator>
 #include <map>
 #include <set>
+#include <string>
+#include <utility>
+#include <vector>
 
-#include "model/graph/undirected_graph.hpp"
+#include <boost/geometry.hpp>
+#include <boost/geometry/index/rtree.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/lexical_cast/bad_lexical_cast.hpp>
+
+#include <osmium/memory/buffer.hpp>
+#include <osmium/osm/area.hpp>
+#include <osmium/osm/node_ref.hpp>
+
+#include "mapmaker/topology.hpp"
+#include "model/boundary.hpp"
+#include "model/graph/components.hpp"
+#include "model/graph/compressed_graph.hpp"
+#include "model/topology.hpp"
 
 #include "functions/intersect.hpp"
+#include "functions/prepared.hpp"
 
 #include "util/insert.hpp"
 
@@ -22,147 +41,358 @@ namespace mapmaker
 
         model::level_type m_level;
 
+        /**
+         * The connected components of the last neighbor graph.
+         */
+        graph::Components m_components;
+
     public:
 
         /* Constructors */
 
         NeighborInspector(model::level_type level) : m_level(level) {};
 
+        /* Accessors */
+
+        /**
+         * Returns the connected components of the last neighbor graph, which
+         * are determined in the same pass as the neighbors. Each vertex has
+         * a path to any other vertex in the same component.
+         */
+        const graph::Components& components() const
+        {
+            return m_components;
+        }
+
+    protected:
+
+        /* Helper Methods */
+
+        /**
+         * Returns the index of a vertex in the sorted vertex list.
+         */
+        static std::size_t index(const std::vector<graph::vertex_type>& vertices, graph::vertex_type vertex)
+        {
+            return std::lower_bound(vertices.begin(), vertices.end(), vertex) - vertices.begin();
+        }
+
+    public:
+
         /* Methods */
 
         /**
-         * Create the neighbor graph for a osmium buffer of areas by checking
-         * which areas contain the same node references. If they do so, they are
-         * considered to be neighbors. As the neighbor relation is symmetric,
-         * the graph is chosen as undirected.
+         * Create the neighbor graph for the areas of the inspected level in a
+         * osmium buffer by checking which areas contain the same node
+         * references. If they do so, they are considered to be neighbors. As
+         * the neighbor relation is symmetric, the graph is chosen as
+         * undirected.
+         * 
+         * The shared nodes are found with the topology of the area rings.
+         * Every node that is shared by two areas is either part of an arc
+         * or a junction that is shared by both areas, so the areas are only
+         * compared once per arc and junction instead of once per node.
          * 
          * @returns The neighbor graph, where vertices represent the areas and
          *          edges represent a neighborship between to areas
          * 
-         * Time complexity: Linear
+         * Time complexity: Log-Linear
          */
-        model::graph::UndirectedGraph run(const osmium::memory::Buffer& buffer)
+        model::graph::CompressedGraph run(const osmium::memory::Buffer& buffer)
         {
-            graph::UndirectedGraph neighbors;
-            
-            std::map<osmium::object_id_type, std::set<osmium::object_id_type>> references{};
+            // Only the areas of the inspected level are considered, as the
+            // buffer may contain the areas of other levels as well
+            std::string level = std::to_string(m_level);
+            std::vector<graph::vertex_type> vertices;
+            TopologyBuilder builder;
             for (const osmium::Area& area : buffer.select<osmium::Area>())
             {
+                if (!area.tags().has_tag("admin_level", level.c_str()))
+                {
+                    continue;
+                }
+
                 // Create a vertex for the area in the neighbor graph
-                neighbors.insert_vertex(area.id());
+                vertices.push_back(area.id());
 
-                // Collect the node references for this area
+                // Add the rings of this area to the topology
                 for (const osmium::OuterRing& outer : area.outer_rings())
                 {
-                    for (const osmium::NodeRef& nr : outer)
-                    {
-                        util::insert(references, nr.ref(), area.id());
-                    }
+                    builder.add(area.id(), outer);
                     for (const osmium::InnerRing& inner : area.inner_rings(outer))
                     {
-                        for (const osmium::NodeRef& nr : inner)
-                        {
-                            util::insert(references, nr.ref(), area.id());
-                        }
+                        builder.add(area.id(), inner);
                     }
                 }
             }
-
-            // Create edges in the graph for each two areas that share a common
-            // node.
-            for (const auto& [node, areas] : references)
+            model::Topology topology = builder.build();
+
+            // Map the areas to dense indices for the neighbor graph and the
+            // component detection
+            std::sort(vertices.begin(), vertices.end());
+            vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+            graph::UnionFind union_find{ vertices.size() };
+
+            // Create edges for each two areas that share a common arc or
+            // junction and merge their components. The owners are mapped to
+            // their indices once, so that the graph is created from the
+            // index pairs directly. The duplicate edges are removed by the
+            // graph.
+            std::vector<std::pair<graph::CompressedGraph::index_type, graph::CompressedGraph::index_type>> edges;
+            std::vector<graph::CompressedGraph::index_type> indices;
+            auto connect = [&](const auto& owners)
             {
-                for (auto it1 = areas.begin(); it1 != areas.end(); it1++)
+                indices.clear();
+                for (std::size_t i = 0; i < owners.size(); i++)
                 {
-                    for (auto it2 = std::next(it1, 1); it2 != areas.end(); it2++)
+                    indices.push_back(index(vertices, owners[i]));
+                }
+                for (std::size_t i = 0; i < indices.size(); i++)
+                {
+                    for (std::size_t j = i + 1; j < indices.size(); j++)
+                    {
+                        edges.emplace_back(indices[i], indices[j]);
+                    }
+                    if (i > 0)
                     {
-                        neighbors.insert_edge(std::make_pair(*it1, *it2));
+                        union_find.unite(indices[0], indices[i]);
                     }
                 }
+            };
+            for (std::size_t i = 0; i < topology.arc_count(); i++)
+            {
+                connect(topology.arc_owners(i));
             }
-
-            return neighbors;
+            for (std::size_t i = 0; i < topology.junction_count(); i++)
+            {
+                connect(topology.junction_owners(i));
+            }
+            m_components = union_find.components(vertices);
+            return graph::CompressedGraph{ std::move(vertices), edges };
         }
 
     };
 
-    class ComponentInspector
+    /**
+     * A class for deriving the hierarchy of areas from the nodes that they
+     * share with the areas of the next lower level.
+     *
+     * Children and parents are assembled from the same ways, so the border
+     * of a child that runs along the border of its parent consists of the
+     * same nodes. Every parent that owns one of these nodes is a candidate,
+     * and the parent of a child has to be a candidate for all of its shared
+     * nodes. A single remaining candidate is the parent if it contains the
+     * bounding box of the child. Otherwise, the parent level does not cover
+     * the child, such as in clipped extracts, and the child is compared with
+     * all parents.
+     *
+     * Children that do not share any node with a parent, such as enclosed
+     * children, or that share their nodes with several candidates, such as
+     * children along the border of two parents, are ambiguous and have to
+     * be resolved geometrically.
+     */
+    class TopologyHierarchyInspector
     {
+    public:
+
+        /* Types */
+
+        using hierarchy_t = std::map<model::object_id_type, std::set<model::object_id_type>>;
+
+        /**
+         * The candidate parents of the ambiguous children. An empty list
+         * means that any parent is a candidate.
+         */
+        using candidates_t = std::map<model::object_id_type, std::vector<model::object_id_type>>;
+
+    protected:
+
+        /* Types */
+
+        using node_owner_type = std::pair<model::object_id_type, model::object_id_type>;
+
+        /* Members */
+
+        /**
+         * The ambiguous children of the last run.
+         */
+        candidates_t m_ambiguous;
+
     public:
 
         /* Constructors */
 
-        ComponentInspector() {}
+        TopologyHierarchyInspector() {}
+
+        /* Accessors */
+
+        const candidates_t& ambiguous() const
+        {
+            return m_ambiguous;
+        }
+
+    protected:
+
+        /* Helper Methods */
+
+        /**
+         * Calls a function for each node of the rings of an area.
+         */
+        template <typename Function>
+        static void for_each_node(const osmium::Area& area, Function fn)
+        {
+            for (const osmium::OuterRing& outer : area.outer_rings())
+            {
+                for (const osmium::NodeRef& node : outer)
+                {
+                    fn(node.ref());
+                }
+                for (const osmium::InnerRing& inner : area.inner_rings(outer))
+                {
+                    for (const osmium::NodeRef& node : inner)
+                    {
+                        fn(node.ref());
+                    }
+                }
+            }
+        }
+
+        /**
+         * Determines the candidate parents of a child, which own all nodes
+         * of the child that are owned by any parent.
+         *
+         * @param area   The child area
+         * @param owners The sorted node owners of the parent level
+         * @returns      The sorted candidates, or an empty list if the
+         *               child does not share any node or the candidates
+         *               contradict each other
+         */
+        std::vector<model::object_id_type> candidates(const osmium::Area& area, const std::vector<node_owner_type>& owners)
+        {
+            std::vector<model::object_id_type> result;
+            std::vector<model::object_id_type> node_owners;
+            std::vector<model::object_id_type> intersection;
+            bool touched = false;
+            bool conflict = false;
+            model::object_id_type previous = 0;
+            for_each_node(area, [&](model::object_id_type ref)
+            {
+                // Consecutive ring nodes are often the same
+                if (conflict || (touched && ref == previous))
+                {
+                    return;
+                }
+                previous = ref;
+                auto first = std::lower_bound(owners.begin(), owners.end(), node_owner_type{ ref, 0 },
+                    [](const node_owner_type& o1, const node_owner_type& o2) { return o1.first < o2.first; });
+                if (first == owners.end() || first->first != ref)
+                {
+                    return;
+                }
+                node_owners.clear();
+                for (auto it = first; it != owners.end() && it->first == ref; it++)
+                {
+                    node_owners.push_back(it->second);
+                }
+                if (!touched)
+                {
+                    result = node_owners;
+                    touched = true;
+                    return;
+                }
+                intersection.clear();
+                std::set_intersection(
+                    result.begin(), result.end(),
+                    node_owners.begin(), node_owners.end(),
+                    std::back_inserter(intersection)
+                );
+                result.swap(intersection);
+                conflict = result.empty();
+            });
+            return result;
+        }
+
+    public:
 
         /* Methods */
 
         /**
-         * Retrieve the connected components of a neighborsship graph, where 
-         * each vertex has a path to any other vertex in the same component.
-         * Components are calculated by performing a depth-first search on the
-         * specified neighbor graph.
+         * Determines the parent of each area on the next lower level of the
+         * areas in a buffer.
          *
-         * @param neighbors The neighbor graph
-         * @returns         The list of connected components, where the index
-         *                  represents the component and the set the areas that
-         *                  are contained in it
+         * @param buffer     The buffer that contains the areas
+         * @param boundaries The boundaries of the areas, whose bounding boxes
+         *                   are used to check single candidates
+         * @returns          The children of each parent that could be
+         *                   derived from the shared nodes. The remaining
+         *                   children are stored as ambiguous children.
          *
-         * Time complexity: Linear
+         * Time complexity: Log-Linear
          */
-        std::vector<std::set<osmium::object_id_type>> run(const model::graph::UndirectedGraph& neighbors)
+        template <typename T>
+        hierarchy_t run(const osmium::memory::Buffer& buffer, const model::BoundaryMap<T>& boundaries)
         {
-            if (neighbors.vertex_count() == 0)
+            m_ambiguous.clear();
+            std::map<model::level_type, std::vector<const osmium::Area*>> level_map;
+            for (const osmium::Area& area : buffer.select<osmium::Area>())
             {
-                return {};
+                try
+                {
+                    level_map[boost::lexical_cast<model::level_type>(area.get_value_by_key("admin_level", "0"))].push_back(&area);
+                }
+                catch (boost::bad_lexical_cast& e)
+                {
+                    // Skip areas with invalid levels
+                }
             }
 
-            // Prepare the component map that stores the component for each
-            // vertex in the neighbor graph.
-            std::map<osmium::object_id_type, std::size_t> components;
+            hierarchy_t hierarchy;
+            if (level_map.size() < 2)
+            {
+                return hierarchy;
+            }
 
-            // Calculate the connected components.
-            std::size_t c = 0;
-            for (const graph::vertex_type& vertex : neighbors.vertices())
+            // Group each two levels
+            std::vector<node_owner_type> owners;
+            for (auto it_h = level_map.rbegin(); it_h != level_map.rend(); it_h++)
             {
-                // Check if the current vertex was visited already
-                if (!components.count(vertex))
+                auto it_l = std::next(it_h, 1);
+                if (it_l == level_map.rend())
+                {
+                    // Last parent reached
+                    break;
+                }
+
+                // Collect the owners of the parent nodes
+                owners.clear();
+                for (const osmium::Area* parent : it_l->second)
                 {
-                    // Perform depth-first-search with the current vertex as
-                    // starting point
-                    std::stack<graph::vertex_type> stack;
-                    stack.push(vertex);
-                    while (!stack.empty())
+                    for_each_node(*parent, [&](model::object_id_type ref) { owners.emplace_back(ref, parent->id()); });
+                }
+                std::sort(owners.begin(), owners.end());
+                owners.erase(std::unique(owners.begin(), owners.end()), owners.end());
+
+                for (const osmium::Area* child : it_h->second)
+                {
+                    std::vector<model::object_id_type> parents = candidates(*child, owners);
+                    if (parents.size() == 1)
                     {
-                        graph::vertex_type v = stack.top();
-                        stack.pop();
-                        // Mark the current vertex as part of the current
-                        // component and add its unvisited adjacents to
-                        // the stack for the next iterations.
-                        components[v] = c;
-                        for (const auto& adjacent : neighbors.adjacents(v))
+                        auto it_c = boundaries.find(child->id());
+                        auto it_p = boundaries.find(parents.front());
+                        if (it_c != boundaries.end() && it_p != boundaries.end()
+                            && functions::rectangle_in_rectangle(it_c->second.bounds, it_p->second.bounds))
                         {
-                            if (!components.count(adjacent))
-                            {
-                                stack.push(adjacent);
-                            }
+                            util::insert(hierarchy, parents.front(), child->id());
+                            continue;
                         }
+                        // The single candidate does not contain the child,
+                        // so that any parent is a candidate
+                        parents.clear();
                     }
-                    // All vertices that were reachable from the chosen start
-                    // vertex were vistied, therefore the connected component
-                    // is complete.
-                    ++c;
+                    m_ambiguous[child->id()] = std::move(parents);
                 }
             }
 
-            // Reverse the component map, such that the component becomes the
-            // index and the areas become the values.
-            std::vector<std::set<osmium::object_id_type>> result(c, std::set<osmium::object_id_type>{});
-            for (const auto& [area, component] : components)
-            {
-                result.at(component).insert(area);
-            }
-
-            return result;
+            return hierarchy;
         }
 
     };
@@ -178,8 +408,25 @@ namespace mapmaker
 
     protected:
 
+        /* Types */
+
+        using point_type = boost::geometry::model::point<T, 2, boost::geometry::cs::cartesian>;
+        using box_type = boost::geometry::model::box<point_type>;
+        using value_type = std::pair<box_type, object_id_type>;
+
+        /**
+         * The spatial index of the bounding boxes of a level.
+         */
+        using index_type = boost::geometry::index::rtree<value_type, boost::geometry::index::rstar<16>>;
+
         /* Members */
 
+        /**
+         * The prepared polygons of the candidates, which are created once
+         * for each candidate and reused for all of its children.
+         */
+        std::map<object_id_type, std::vector<functions::PreparedPolygon<T>>> m_prepared;
+
     public:
 
         /* Constructors */
@@ -190,28 +437,77 @@ namespace mapmaker
 
         /* Helper Methods */
 
+        static box_type box(const geometry::Rectangle<T>& rectangle)
+        {
+            return box_type{
+                point_type{ rectangle.min().x(), rectangle.min().y() },
+                point_type{ rectangle.max().x(), rectangle.max().y() }
+            };
+        }
+
+        /**
+         * Creates the spatial index for the bounding boxes of a set of
+         * boundaries. The index is bulk loaded, which packs the boxes
+         * into the tree nodes at once.
+         */
+        index_type create_index(
+            const BoundaryMap<T>& boundaries,
+            const std::set<object_id_type>& ids
+        ) {
+            std::vector<value_type> values;
+            values.reserve(ids.size());
+            for (const object_id_type& id : ids)
+            {
+                values.emplace_back(box(boundaries.at(id).bounds), id);
+            }
+            return index_type{ values.begin(), values.end() };
+        }
+
+        /**
+         * Returns the prepared polygons of a boundary.
+         */
+        const std::vector<functions::PreparedPolygon<T>>& prepared(const Boundary<T>& boundary)
+        {
+            auto it = m_prepared.find(boundary.id);
+            if (it == m_prepared.end())
+            {
+                std::vector<functions::PreparedPolygon<T>> polygons;
+                for (const geometry::Polygon<T>& polygon : boundary.geometry.polygons())
+                {
+                    polygons.emplace_back(polygon);
+                }
+                it = m_prepared.emplace(boundary.id, std::move(polygons)).first;
+            }
+            return it->second;
+        }
+
+        /**
+         * Tests the geometries of the candidates in the specified order and
+         * returns the first candidate that contains the child boundary.
+         */
         object_id_type group(
-            const std::map<object_id_type, Boundary<T>>& boundaries,
+            const BoundaryMap<T>& boundaries,
             object_id_type id,
-            std::set<object_id_type> candidates
+            const std::vector<object_id_type>& candidates
         ) {
             // Retrieve the child boundary
             const Boundary<T>& child = boundaries.at(id);
+
             for (const object_id_type& c : candidates)
             {
                 // Retrieve the potential parent boundary
-                const Boundary<T>& candidate = boundaries.at(c);
-                // Compare bounding boxes first
-                if (!functions::rectangle_in_rectangle(child.bounds, candidate.bounds))
+                auto it = boundaries.find(c);
+                if (it == boundaries.end())
                 {
                     continue;
                 }
-                // Compare the actual geometries
+                // Compare the actual geometries with the prepared polygons of
+                // the candidate
                 for (const geometry::Polygon<T>& p_child : child.geometry.polygons())
                 {
-                    for (const geometry::Polygon<T>& p_candidate : candidate.geometry.polygons())
+                    for (const functions::PreparedPolygon<T>& p_candidate : prepared(it->second))
                     {
-                        if (functions::polygon_in_polygon(p_child, p_candidate))
+                        if (p_candidate.contains(p_child))
                         {
                             // Parent found
                             return c;
@@ -223,17 +519,55 @@ namespace mapmaker
             return -1;
         }
 
-    public:
-
-        /* Methods */
+        object_id_type group(
+            const BoundaryMap<T>& boundaries,
+            object_id_type id,
+            const index_type& index
+        ) {
+            // Only the candidates whose bounding boxes contain the bounding
+            // box of the child can be parents. They are tested in the order
+            // of their ids.
+            std::vector<value_type> results;
+            index.query(boost::geometry::index::covers(box(boundaries.at(id).bounds)), std::back_inserter(results));
+            std::vector<object_id_type> candidates;
+            candidates.reserve(results.size());
+            for (const value_type& result : results)
+            {
+                candidates.push_back(result.second);
+            }
+            std::sort(candidates.begin(), candidates.end());
+            return group(boundaries, id, candidates);
+        }
 
-        hierarchy_t run(const std::map<object_id_type, Boundary<T>>& boundaries)
-        {
+        std::map<level_type, std::set<object_id_type>> create_level_map(
+            const BoundaryMap<T>& boundaries
+        ) {
             std::map<level_type, std::set<object_id_type>> level_map;
             for (const auto& [id, boundary] : boundaries)
             {
                 util::insert(level_map, boundary.level, boundary.id);
             }
+            return level_map;
+        }
+
+    public:
+
+        /* Methods */
+
+        /**
+         * Determines the parent of each boundary on the next lower level.
+         * The candidates of each level are stored in a spatial index, so
+         * that each child is only compared with the few candidates whose
+         * bounding boxes contain its own.
+         *
+         * @param boundaries The boundaries
+         * @returns          The children of each parent
+         *
+         * Time complexity: Log-Linear (Average-case)
+         */
+        hierarchy_t run(const BoundaryMap<T>& boundaries)
+        {
+            std::map<level_type, std::set<object_id_type>> level_map = create_level_map(boundaries);
             
             hierarchy_t hierarchy;
             if (level_map.size() < 2)
@@ -250,9 +584,10 @@ namespace mapmaker
                     // Last parent reached
                     break;
                 }
+                index_type index = create_index(boundaries, it_l->second);
                 for (const object_id_type& child : it_h->second)
                 {
-                    object_id_type parent = group(boundaries, child, it_l->second);
+                    object_id_type parent = group(boundaries, child, index);
                     if (parent >= 0)
                     {
                         util::insert(hierarchy, parent, child);
@@ -263,6 +598,67 @@ namespace mapmaker
             return hierarchy;
         }
 
+        /**
+         * Completes a hierarchy that was derived from the topology of the
+         * boundaries by determining the parents of the ambiguous children
+         * geometrically. Only the candidates of a child are compared, or
+         * all boundaries of the next lower level if it has none.
+         *
+         * @param boundaries The boundaries
+         * @param hierarchy  The topological hierarchy
+         * @param ambiguous  The candidate parents of the ambiguous children
+         * @returns          The children of each parent
+         *
+         * Time complexity: Log-Linear (Average-case)
+         */
+        hierarchy_t run(
+            const BoundaryMap<T>& boundaries,
+            const hierarchy_t& hierarchy,
+            const std::map<object_id_type, std::vector<object_id_type>>& ambiguous
+        ) {
+            std::map<level_type, std::set<object_id_type>> level_map = create_level_map(boundaries);
+            hierarchy_t result = hierarchy;
+
+            // The spatial indices are only created for the levels that
+            // contain parents of children without candidates
+            std::map<level_type, index_type> indices;
+            for (const auto& [child, candidates] : ambiguous)
+            {
+                auto it_c = boundaries.find(child);
+                if (it_c == boundaries.end())
+                {
+                    continue;
+                }
+                auto it_l = level_map.find(it_c->second.level);
+                if (it_l == level_map.begin())
+                {
+                    // Children of the lowest level have no parents
+                    continue;
+                }
+                it_l = std::prev(it_l, 1);
+                object_id_type parent = -1;
+                if (candidates.empty())
+                {
+                    auto it_i = indices.find(it_l->first);
+                    if (it_i == indices.end())
+                    {
+                        it_i = indices.emplace(it_l->first, create_index(boundaries, it_l->second)).first;
+                    }
+                    parent = group(boundaries, child, it_i->second);
+                }
+                else
+                {
+                    parent = group(boundaries, child, candidates);
+                }
+                if (parent >= 0)
+                {
+                    util::insert(result, parent, child);
+                }
+            }
+
+            return result;
+        }
+
     };
 
 }
\ No newline at end of file
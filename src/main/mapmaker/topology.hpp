@@ -0,0 +1,333 @@
+#pragma once
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <osmium/osm/node_ref.hpp>
+#include <osmium/osm/node_ref_list.hpp>
+
+#include "model/topology.hpp"
+#include "model/types.hpp"
+
+namespace mapmaker
+{
+
+    /**
+     * A class for building the shared-edge topology of a collection of
+     * polylines. The polylines are referenced, so their buffer has to
+     * outlive the builder.
+     */
+    class TopologyBuilder
+    {
+    protected:
+
+        /* Types */
+
+        using id_set_type = model::Topology::id_set_type;
+        using node_pair_type = std::pair<model::object_id_type, model::object_id_type>;
+
+        /**
+         * A polyline and the id of its owner.
+         */
+        struct Polyline
+        {
+            model::object_id_type owner;
+            const osmium::NodeRefList* nodes;
+        };
+
+        /**
+         * An occurrence of an arc in a polyline. The positions are unwrapped
+         * for closed polylines, so that the last position may exceed the
+         * polyline size.
+         */
+        struct Occurrence
+        {
+            node_pair_type key;
+            std::size_t polyline;
+            std::size_t first;
+            std::size_t last;
+            bool reversed;
+        };
+
+        /* Members */
+
+        std::vector<Polyline> m_polylines;
+
+    public:
+
+        /* Constructors */
+
+        TopologyBuilder() {}
+
+        /* Methods */
+
+        /**
+         * Adds a polyline to the topology.
+         *
+         * @param owner The id of the owner, such as the way or area id
+         * @param nodes The node reference list of the polyline
+         */
+        void add(model::object_id_type owner, const osmium::NodeRefList& nodes)
+        {
+            m_polylines.push_back(Polyline{ owner, &nodes });
+        }
+
+    protected:
+
+        /* Helper Methods */
+
+        static bool is_closed(const osmium::NodeRefList& nodes)
+        {
+            return nodes.size() > 2 && nodes.front().ref() == nodes.back().ref();
+        }
+
+        /**
+         * Returns the node at an unwrapped position of a polyline.
+         */
+        static const osmium::NodeRef& at(const osmium::NodeRefList& nodes, std::size_t position)
+        {
+            return is_closed(nodes) ? nodes[position % (nodes.size() - 1)] : nodes[position];
+        }
+
+        static bool is_junction(const id_set_type& junctions, const osmium::NodeRef& node)
+        {
+            return junctions.get(node.positive_ref());
+        }
+
+        /**
+         * Determines the junctions of the polylines.
+         */
+        id_set_type find_junctions() const
+        {
+            // Collect the distinct pairs of adjacent nodes in both directions
+            std::vector<node_pair_type> pairs;
+            for (const Polyline& polyline : m_polylines)
+            {
+                const osmium::NodeRefList& nodes = *polyline.nodes;
+                for (std::size_t i = 1; i < nodes.size(); i++)
+                {
+                    if (nodes[i - 1].ref() != nodes[i].ref())
+                    {
+                        pairs.emplace_back(nodes[i - 1].ref(), nodes[i].ref());
+                        pairs.emplace_back(nodes[i].ref(), nodes[i - 1].ref());
+                    }
+                }
+            }
+            std::sort(pairs.begin(), pairs.end());
+            pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+            // Nodes that do not have exactly two distinct adjacent nodes are
+            // junctions
+            id_set_type junctions;
+            for (std::size_t i = 0, j = 0; i < pairs.size(); i = j)
+            {
+                while (j < pairs.size() && pairs[j].first == pairs[i].first)
+                {
+                    j++;
+                }
+                if (j - i != 2)
+                {
+                    junctions.set(osmium::NodeRef{ pairs[i].first }.positive_ref());
+                }
+            }
+
+            // The ends of open polylines are junctions as well, just like
+            // nodes where a polyline turns back to its previous node
+            std::vector<osmium::NodeRef> refs;
+            for (const Polyline& polyline : m_polylines)
+            {
+                const osmium::NodeRefList& nodes = *polyline.nodes;
+                if (nodes.empty())
+                {
+                    continue;
+                }
+                refs.clear();
+                for (const osmium::NodeRef& node : nodes)
+                {
+                    if (refs.empty() || refs.back().ref() != node.ref())
+                    {
+                        refs.push_back(node);
+                    }
+                }
+                bool closed = is_closed(nodes);
+                if (closed)
+                {
+                    refs.pop_back();
+                }
+                else
+                {
+                    junctions.set(refs.front().positive_ref());
+                    junctions.set(refs.back().positive_ref());
+                }
+                std::size_t n = refs.size();
+                std::size_t begin = closed ? 0 : 1;
+                std::size_t end = closed ? n : n - 1;
+                for (std::size_t i = begin; i < end; i++)
+                {
+                    if (refs[(i + n - 1) % n].ref() == refs[(i + 1) % n].ref())
+                    {
+                        junctions.set(refs[i].positive_ref());
+                    }
+                }
+            }
+
+            // Closed polylines without junctions are split at their first
+            // node, so that every polyline consists of arcs
+            for (const Polyline& polyline : m_polylines)
+            {
+                const osmium::NodeRefList& nodes = *polyline.nodes;
+                if (is_closed(nodes) && std::none_of(nodes.begin(), nodes.end(),
+                    [&](const osmium::NodeRef& node) { return is_junction(junctions, node); }))
+                {
+                    junctions.set(nodes.front().positive_ref());
+                }
+            }
+            return junctions;
+        }
+
+        /**
+         * Adds the occurrence of an arc between two positions of a polyline
+         * if the arc contains at least two distinct nodes.
+         */
+        void add_occurrence(
+            std::vector<Occurrence>& occurrences,
+            std::size_t index,
+            std::size_t first,
+            std::size_t last
+        ) const {
+            const osmium::NodeRefList& nodes = *m_polylines[index].nodes;
+            model::object_id_type start = at(nodes, first).ref();
+            model::object_id_type end = at(nodes, last).ref();
+
+            // Find the second and the penultimate distinct node, which
+            // identify the arc together with its junctions
+            std::size_t second = first + 1;
+            while (second <= last && at(nodes, second).ref() == start)
+            {
+                second++;
+            }
+            if (second > last)
+            {
+                return;
+            }
+            std::size_t penultimate = last - 1;
+            while (at(nodes, penultimate).ref() == end)
+            {
+                penultimate--;
+            }
+            node_pair_type forward{ start, at(nodes, second).ref() };
+            node_pair_type backward{ end, at(nodes, penultimate).ref() };
+            bool reversed = backward < forward;
+            occurrences.push_back(Occurrence{ reversed ? backward : forward, index, first, last, reversed });
+        }
+
+    public:
+
+        /**
+         * Builds the topology of the added polylines.
+         *
+         * @returns The topology
+         *
+         * Time complexity: Log-Linear
+         */
+        model::Topology build() const
+        {
+            id_set_type junctions = find_junctions();
+
+            // Walk the polylines from junction to junction and collect the
+            // arc occurrences and the owners of the junctions
+            std::vector<Occurrence> occurrences;
+            std::vector<node_pair_type> junction_owners;
+            for (std::size_t index = 0; index < m_polylines.size(); index++)
+            {
+                const Polyline& polyline = m_polylines[index];
+                const osmium::NodeRefList& nodes = *polyline.nodes;
+                if (nodes.empty())
+                {
+                    continue;
+                }
+                std::size_t start = 0;
+                std::size_t end = nodes.size() - 1;
+                if (is_closed(nodes))
+                {
+                    // Start closed polylines at their first junction
+                    while (!is_junction(junctions, nodes[start]))
+                    {
+                        start++;
+                    }
+                    end = start + nodes.size() - 1;
+                }
+                std::size_t first = start;
+                junction_owners.emplace_back(at(nodes, start).ref(), polyline.owner);
+                for (std::size_t position = start + 1; position <= end; position++)
+                {
+                    const osmium::NodeRef& node = at(nodes, position);
+                    if (is_junction(junctions, node))
+                    {
+                        junction_owners.emplace_back(node.ref(), polyline.owner);
+                        add_occurrence(occurrences, index, first, position);
+                        first = position;
+                    }
+                }
+            }
+
+            model::Topology topology;
+
+            // Group the occurrences of each arc and store the arc once in its
+            // canonical direction
+            std::sort(occurrences.begin(), occurrences.end(), [](const Occurrence& o1, const Occurrence& o2)
+            {
+                return std::tie(o1.key, o1.polyline, o1.first) < std::tie(o2.key, o2.polyline, o2.first);
+            });
+            std::vector<osmium::NodeRef> nodes;
+            std::vector<model::object_id_type> owners;
+            for (std::size_t i = 0, j = 0; i < occurrences.size(); i = j)
+            {
+                owners.clear();
+                while (j < occurrences.size() && occurrences[j].key == occurrences[i].key)
+                {
+                    owners.push_back(m_polylines[occurrences[j].polyline].owner);
+                    j++;
+                }
+                std::sort(owners.begin(), owners.end());
+                owners.erase(std::unique(owners.begin(), owners.end()), owners.end());
+
+                // Copy the nodes of the first occurrence without duplicates
+                const Occurrence& occurrence = occurrences[i];
+                const osmium::NodeRefList& polyline = *m_polylines[occurrence.polyline].nodes;
+                nodes.clear();
+                for (std::size_t k = 0; k <= occurrence.last - occurrence.first; k++)
+                {
+                    std::size_t position = occurrence.reversed ? occurrence.last - k : occurrence.first + k;
+                    const osmium::NodeRef& node = at(polyline, position);
+                    if (nodes.empty() || nodes.back().ref() != node.ref())
+                    {
+                        nodes.push_back(node);
+                    }
+                }
+                topology.add_arc(nodes, owners);
+            }
+
+            // Group the owners of each junction
+            std::sort(junction_owners.begin(), junction_owners.end());
+            junction_owners.erase(std::unique(junction_owners.begin(), junction_owners.end()), junction_owners.end());
+            for (std::size_t i = 0, j = 0; i < junction_owners.size(); i = j)
+            {
+                owners.clear();
+                while (j < junction_owners.size() && junction_owners[j].first == junction_owners[i].first)
+                {
+                    owners.push_back(junction_owners[j].second);
+                    j++;
+                }
+                topology.add_junction(junction_owners[i].first, owners);
+            }
+
+            topology.set_junctions(std::move(junctions));
+            return topology;
+        }
+
+    };
+
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <string>
+
+#include "model/flat_map.hpp"
 #include "model/geometry/point.hpp"
 #include "model/geometry/rectangle.hpp"
 #include "model/geometry/multipolygon.hpp"
@@ -19,4 +22,10 @@ namespace model
         geometry::Point<T> center;
     };
 
+    /**
+     * The boundaries of a map, sorted by their ids.
+     */
+    template <typename T>
+    using BoundaryMap = FlatMap<object_id_type, Boundary<T>>;
+
 }
\ No newline at end of file
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace model
+{
+
+    /**
+     * A map that stores its entries in a vector sorted by their keys. The
+     * entries are stored contiguously and looked up with a binary search,
+     * so that iterating and searching is faster than with a std::map.
+     * Entries can only be added at once on construction, but their values
+     * can be modified.
+     */
+    template <typename K, typename V>
+    class FlatMap
+    {
+    public:
+
+        /* Types */
+
+        using value_type = std::pair<K, V>;
+        using iterator = typename std::vector<value_type>::iterator;
+        using const_iterator = typename std::vector<value_type>::const_iterator;
+
+    protected:
+
+        /* Members */
+
+        std::vector<value_type> m_entries;
+
+        /* Helper Methods */
+
+        static bool compare(const value_type& entry, const K& key)
+        {
+            return entry.first < key;
+        }
+
+    public:
+
+        /* Constructors */
+
+        FlatMap() {}
+
+        /**
+         * Creates the map from a list of entries. If a key occurs more
+         * than once, the last entry with this key is kept.
+         *
+         * @param entries The entries
+         *
+         * Time complexity: Log-Linear, Linear if the entries are sorted
+         */
+        FlatMap(std::vector<value_type>&& entries) : m_entries(std::move(entries))
+        {
+            auto by_key = [](const value_type& e1, const value_type& e2) { return e1.first < e2.first; };
+            if (!std::is_sorted(m_entries.begin(), m_entries.end(), by_key))
+            {
+                std::stable_sort(m_entries.begin(), m_entries.end(), by_key);
+            }
+            // Keep the last entry of each key
+            std::reverse(m_entries.begin(), m_entries.end());
+            auto last = std::unique(m_entries.begin(), m_entries.end(),
+                [](const value_type& e1, const value_type& e2) { return e1.first == e2.first; });
+            m_entries.erase(last, m_entries.end());
+            std::reverse(m_entries.begin(), m_entries.end());
+        }
+
+        /* Accessors */
+
+        std::size_t size() const noexcept
+        {
+            return m_entries.size();
+        }
+
+        bool empty() const noexcept
+        {
+            return m_entries.empty();
+        }
+
+        iterator begin() noexcept { return m_entries.begin(); }
+        iterator end() noexcept { return m_entries.end(); }
+        const_iterator begin() const noexcept { return m_entries.begin(); }
+        const_iterator end() const noexcept { return m_entries.end(); }
+
+        /* Methods */
+
+        /**
+         * Returns an iterator to the entry of a key or the end iterator if
+         * the map does not contain the key.
+         *
+         * Time complexity: Logarithmic
+         */
+        iterator find(const K& key)
+        {
+            auto it = std::lower_bound(m_entries.begin(), m_entries.end(), key, compare);
+            return it != m_entries.end() && it->first == key ? it : m_entries.end();
+        }
+
+        const_iterator find(const K& key) const
+        {
+            auto it = std::lower_bound(m_entries.begin(), m_entries.end(), key, compare);
+            return it != m_entries.end() && it->first == key ? it : m_entries.end();
+        }
+
+        std::size_t count(const K& key) const
+        {
+            return find(key) != end();
+        }
+
+        /**
+         * Returns the value of a key.
+         *
+         * @throws std::out_of_range if the map does not contain the key
+         *
+         * Time complexity: Logarithmic
+         */
+        V& at(const K& key)
+        {
+            auto it = find(key);
+            if (it == end())
+            {
+                throw std::out_of_range("Key does not exist");
+            }
+            return it->second;
+        }
+
+        const V& at(const K& key) const
+        {
+            auto it = find(key);
+            if (it == end())
+            {
+                throw std::out_of_range("Key does not exist");
+            }
+            return it->second;
+        }
+
+    };
+
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <cstddef>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "model/graph/vertex.hpp"
+#include "model/range.hpp"
+
+namespace model
+{
+
+    namespace graph
+    {
+
+        /**
+         * A list of connected components, where the vertices of all
+         * components are stored consecutively.
+         */
+        class Components
+        {
+        protected:
+
+            /* Members */
+
+            /**
+             * The vertices of all components, which are stored in ascending
+             * order for each component.
+             */
+            std::vector<vertex_type> m_vertices;
+
+            /**
+             * The vertex offsets of the components, including the end offset.
+             */
+            std::vector<std::size_t> m_offsets{ 0 };
+
+        public:
+
+            /* Constructors */
+
+            Components() {}
+
+            /* Accessors */
+
+            std::size_t size() const
+            {
+                return m_offsets.size() - 1;
+            }
+
+            bool empty() const
+            {
+                return size() == 0;
+            }
+
+            /**
+             * Returns the vertices of a component.
+             */
+            Range<vertex_type> operator[](std::size_t index) const
+            {
+                return Range<vertex_type>{
+                    m_vertices.data() + m_offsets[index],
+                    m_vertices.data() + m_offsets[index + 1]
+                };
+            }
+
+            /* Methods */
+
+            /**
+             * Appends a component.
+             *
+             * @param vertices The sorted vertices of the component
+             */
+            template <typename VertexContainer>
+            void add(const VertexContainer& vertices)
+            {
+                m_vertices.insert(m_vertices.end(), vertices.begin(), vertices.end());
+                m_offsets.push_back(m_vertices.size());
+            }
+
+        };
+
+        /**
+         * A disjoint-set forest over dense vertex indices, which merges the
+         * sets of connected vertices with union by size and path halving.
+         */
+        class UnionFind
+        {
+        protected:
+
+            /* Members */
+
+            std::vector<std::size_t> m_parents;
+            std::vector<std::size_t> m_sizes;
+
+        public:
+
+            /* Constructors */
+
+            UnionFind(std::size_t count) : m_parents(count), m_sizes(count, 1)
+            {
+                std::iota(m_parents.begin(), m_parents.end(), std::size_t(0));
+            }
+
+            /* Methods */
+
+            /**
+             * Returns the representative index of the set of an index.
+             *
+             * Time complexity: Amortized almost constant
+             */
+            std::size_t find(std::size_t index)
+            {
+                while (m_parents[index] != index)
+                {
+                    m_parents[index] = m_parents[m_parents[index]];
+                    index = m_parents[index];
+                }
+                return index;
+            }
+
+            /**
+             * Merges the sets of two indices.
+             *
+             * Time complexity: Amortized almost constant
+             */
+            void unite(std::size_t first, std::size_t second)
+            {
+                first = find(first);
+                second = find(second);
+                if (first == second)
+                {
+                    return;
+                }
+                if (m_sizes[first] < m_sizes[second])
+                {
+                    std::swap(first, second);
+                }
+                m_parents[second] = first;
+                m_sizes[first] += m_sizes[second];
+            }
+
+            /**
+             * Returns the sets as components. The components are ordered by
+             * their smallest index.
+             *
+             * @param vertices The vertices of the indices in ascending order
+             * @returns        The components
+             *
+             * Time complexity: Linear
+             */
+            Components components(const std::vector<vertex_type>& vertices)
+            {
+                // Number the sets in the order of their smallest index and
+                // count their vertices
+                const std::size_t unassigned = m_parents.size();
+                std::vector<std::size_t> numbers(m_parents.size(), unassigned);
+                std::vector<std::size_t> offsets{ 0 };
+                for (std::size_t i = 0; i < m_parents.size(); i++)
+                {
+                    std::size_t root = find(i);
+                    if (numbers[root] == unassigned)
+                    {
+                        numbers[root] = offsets.size() - 1;
+                        offsets.push_back(0);
+                    }
+                    offsets[numbers[root] + 1]++;
+                }
+                std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+                // Place the vertices of each set consecutively, which keeps
+                // them in ascending order
+                std::vector<vertex_type> sorted(m_parents.size());
+                std::vector<std::size_t> positions(offsets.begin(), offsets.end() - 1);
+                for (std::size_t i = 0; i < m_parents.size(); i++)
+                {
+                    sorted[positions[numbers[find(i)]]++] = vertices[i];
+                }
+
+                Components result;
+                for (std::size_t c = 0; c + 1 < offsets.size(); c++)
+                {
+                    result.add(Range<vertex_type>{ sorted.data() + offsets[c], sorted.data() + offsets[c + 1] });
+                }
+                return result;
+            }
+
+        };
+
+    }
+
+}
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "model/graph/vertex.hpp"
+#include "model/range.hpp"
+
+namespace model
+{
+
+    namespace graph
+    {
+
+        /**
+         * An immutable undirected graph in compressed sparse row layout.
+         *
+         * The vertices are mapped to dense indices in ascending order of
+         * their ids. The adjacent vertex indices of all vertices are stored
+         * consecutively, so that the degree and the adjacents of a vertex
+         * can be retrieved in constant time. Use the UndirectedGraph if the
+         * graph has to be edited.
+         */
+        class CompressedGraph
+        {
+        public:
+
+            /* Types */
+
+            using index_type = std::size_t;
+
+            /* Constants */
+
+            /**
+             * The index that represents a vertex that does not exist.
+             */
+            static constexpr index_type npos = std::numeric_limits<index_type>::max();
+
+        protected:
+
+            /* Members */
+
+            /**
+             * The sorted vertex ids, where the position is the vertex index.
+             */
+            std::vector<vertex_type> m_vertices;
+
+            /**
+             * The adjacent offsets of the vertices, including the end offset.
+             */
+            std::vector<std::size_t> m_offsets{ 0 };
+
+            /**
+             * The adjacent vertex indices of all vertices, which are stored
+             * consecutively and in ascending order for each vertex.
+             */
+            std::vector<index_type> m_adjacents;
+
+        public:
+
+            /* Constructors */
+
+            CompressedGraph() {}
+
+            /**
+             * Creates a graph from a list of vertices and a list of edges
+             * between their indices. The adjacents are distributed to their
+             * vertices by counting, so that only the adjacents of each
+             * vertex have to be sorted. Duplicate edges and loops are
+             * removed.
+             *
+             * @param vertices The sorted and unique vertex ids
+             * @param edges    The edges as <index, index> pairs in any
+             *                 direction
+             *
+             * Time complexity: Log-Linear in the degree of each vertex
+             */
+            CompressedGraph(std::vector<vertex_type> vertices, const std::vector<std::pair<index_type, index_type>>& edges)
+            : m_vertices(std::move(vertices))
+            {
+                // Count the adjacents of each vertex first, so that they can
+                // be stored without reallocations
+                m_offsets.assign(m_vertices.size() + 1, 0);
+                for (const auto& [source, target] : edges)
+                {
+                    if (source != target)
+                    {
+                        m_offsets[source + 1]++;
+                        m_offsets[target + 1]++;
+                    }
+                }
+                for (index_type i = 0; i < m_vertices.size(); i++)
+                {
+                    m_offsets[i + 1] += m_offsets[i];
+                }
+                m_adjacents.resize(m_offsets.back());
+                std::vector<std::size_t> positions{ m_offsets.begin(), m_offsets.end() - 1 };
+                for (const auto& [source, target] : edges)
+                {
+                    if (source != target)
+                    {
+                        m_adjacents[positions[source]++] = target;
+                        m_adjacents[positions[target]++] = source;
+                    }
+                }
+
+                // Sort the adjacents of each vertex and move them to the
+                // front after removing the duplicates
+                std::size_t size = 0;
+                for (index_type i = 0; i < m_vertices.size(); i++)
+                {
+                    auto first = m_adjacents.begin() + m_offsets[i];
+                    auto last = m_adjacents.begin() + m_offsets[i + 1];
+                    std::sort(first, last);
+                    last = std::unique(first, last);
+                    m_offsets[i] = size;
+                    size = std::move(first, last, m_adjacents.begin() + size) - m_adjacents.begin();
+                }
+                m_offsets.back() = size;
+                m_adjacents.resize(size);
+            }
+
+            /* Accessors */
+
+            /**
+             * Returns the sorted vertex ids.
+             */
+            const std::vector<vertex_type>& vertices() const
+            {
+                return m_vertices;
+            }
+
+            std::size_t vertex_count() const
+            {
+                return m_vertices.size();
+            }
+
+            std::size_t edge_count() const
+            {
+                return m_adjacents.size() / 2;
+            }
+
+            bool empty() const
+            {
+                return m_vertices.empty();
+            }
+
+            /* Methods */
+
+            /**
+             * Returns the id of a vertex.
+             *
+             * @param index The vertex index
+             *
+             * Time complexity: Constant
+             */
+            vertex_type vertex(index_type index) const
+            {
+                return m_vertices[index];
+            }
+
+            /**
+             * Returns the index of a vertex.
+             *
+             * @param vertex The vertex id
+             * @returns      The vertex index or npos if the vertex does
+             *               not exist
+             *
+             * Time complexity: Logarithmic
+             */
+            index_type find(const vertex_type& vertex) const
+            {
+                auto it = std::lower_bound(m_vertices.begin(), m_vertices.end(), vertex);
+                return it != m_vertices.end() && *it == vertex ? it - m_vertices.begin() : npos;
+            }
+
+            /**
+             * Returns the index of a vertex.
+             *
+             * @param vertex The vertex id
+             * @throws       std::out_of_range If the vertex does not exist
+             *
+             * Time complexity: Logarithmic
+             */
+            index_type index(const vertex_type& vertex) const
+            {
+                index_type i = find(vertex);
+                if (i == npos)
+                {
+                    throw std::out_of_range("Vertex " + std::to_string(vertex) + " does not exist");
+                }
+                return i;
+            }
+
+            bool contains_vertex(const vertex_type& vertex) const
+            {
+                return find(vertex) != npos;
+            }
+
+            /**
+             * Returns the degree (number of adjacent vertices) of a vertex.
+             *
+             * @param index The vertex index
+             *
+             * Time complexity: Constant
+             */
+            std::size_t degree(index_type index) const
+            {
+                return m_offsets[index + 1] - m_offsets[index];
+            }
+
+            /**
+             * Returns the sorted indices of the adjacent vertices of a
+             * vertex.
+             *
+             * @param index The vertex index
+             *
+             * Time complexity: Constant
+             */
+            Range<index_type> adjacents(index_type index) const
+            {
+                return Range<index_type>{
+                    m_adjacents.data() + m_offsets[index],
+                    m_adjacents.data() + m_offsets[index + 1]
+                };
+            }
+
+        };
+
+    }
+
+}
@@ -31,6 +31,9 @@ namespace model
         // Boundary information
         std::size_t boundaries;
         std::map<level_type, std::size_t> levels;
+        // Whether the nodes and ways were counted. Fast header scans only
+        // read the relations and take the bounds from the file header.
+        bool counted = true;
     };
 
 }
\ No newline at end of file
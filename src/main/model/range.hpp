@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+
+namespace model
+{
+
+    /**
+     * A read-only view on a contiguous range of values.
+     */
+    template <typename T>
+    class Range
+    {
+    protected:
+
+        /* Members */
+
+        const T* m_begin;
+        const T* m_end;
+
+    public:
+
+        /* Constructors */
+
+        Range(const T* begin, const T* end) : m_begin(begin), m_end(end) {}
+
+        /* Accessors */
+
+        const T* begin() const { return m_begin; }
+        const T* end() const { return m_end; }
+        std::size_t size() const { return m_end - m_begin; }
+        bool empty() const { return m_begin == m_end; }
+        const T& operator[](std::size_t i) const { return m_begin[i]; }
+    };
+
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <osmium/index/id_set.hpp>
+#include <osmium/osm/node_ref.hpp>
+#include <osmium/osm/types.hpp>
+
+#include "model/range.hpp"
+#include "model/types.hpp"
+
+namespace model
+{
+
+    /**
+     * A shared-edge topology of a collection of polylines, such as the ways
+     * of boundaries or the rings of areas.
+     *
+     * The polylines are split into arcs at junction nodes. A junction is a
+     * node with more than two distinct adjacent nodes or the end of an open
+     * polyline. Therefore, every polyline that contains an inner node of an
+     * arc contains the whole arc, and each arc is stored only once together
+     * with the owners of all polylines that contain it.
+     */
+    class Topology
+    {
+    public:
+
+        /* Types */
+
+        using id_set_type = osmium::index::IdSetDense<osmium::unsigned_object_id_type>;
+
+    protected:
+
+        /* Members */
+
+        /**
+         * The nodes of all arcs, which are stored consecutively.
+         */
+        std::vector<osmium::NodeRef> m_nodes;
+
+        /**
+         * The node offsets of the arcs, including the end offset.
+         */
+        std::vector<std::size_t> m_arc_offsets{ 0 };
+
+        /**
+         * The owners of all arcs, which are stored consecutively.
+         */
+        std::vector<object_id_type> m_arc_owners;
+
+        /**
+         * The owner offsets of the arcs, including the end offset.
+         */
+        std::vector<std::size_t> m_arc_owner_offsets{ 0 };
+
+        /**
+         * The sorted junction node ids.
+         */
+        std::vector<object_id_type> m_junction_ids;
+
+        /**
+         * The owners of all junctions, which are stored consecutively.
+         */
+        std::vector<object_id_type> m_junction_owners;
+
+        /**
+         * The owner offsets of the junctions, including the end offset.
+         */
+        std::vector<std::size_t> m_junction_owner_offsets{ 0 };
+
+        /**
+         * The set of junction node ids.
+         */
+        id_set_type m_junctions;
+
+    public:
+
+        /* Constructors */
+
+        Topology() {}
+
+        /* Accessors */
+
+        std::size_t arc_count() const
+        {
+            return m_arc_offsets.size() - 1;
+        }
+
+        /**
+         * Returns the nodes of an arc. The first and the last node are
+         * junctions.
+         */
+        Range<osmium::NodeRef> arc(std::size_t index) const
+        {
+            return Range<osmium::NodeRef>{
+                m_nodes.data() + m_arc_offsets[index],
+                m_nodes.data() + m_arc_offsets[index + 1]
+            };
+        }
+
+        /**
+         * Returns the sorted owners of the polylines that contain an arc.
+         */
+        Range<object_id_type> arc_owners(std::size_t index) const
+        {
+            return Range<object_id_type>{
+                m_arc_owners.data() + m_arc_owner_offsets[index],
+                m_arc_owners.data() + m_arc_owner_offsets[index + 1]
+            };
+        }
+
+        std::size_t junction_count() const
+        {
+            return m_junction_ids.size();
+        }
+
+        object_id_type junction(std::size_t index) const
+        {
+            return m_junction_ids[index];
+        }
+
+        /**
+         * Returns the sorted owners of the polylines that contain a junction.
+         */
+        Range<object_id_type> junction_owners(std::size_t index) const
+        {
+            return Range<object_id_type>{
+                m_junction_owners.data() + m_junction_owner_offsets[index],
+                m_junction_owners.data() + m_junction_owner_offsets[index + 1]
+            };
+        }
+
+        /**
+         * Returns the set of junction node ids.
+         */
+        const id_set_type& junctions() const
+        {
+            return m_junctions;
+        }
+
+        /* Methods */
+
+        /**
+         * Appends an arc to the topology.
+         *
+         * @param nodes  The nodes of the arc
+         * @param owners The sorted owners of the arc
+         */
+        template <typename NodeContainer, typename OwnerContainer>
+        void add_arc(const NodeContainer& nodes, const OwnerContainer& owners)
+        {
+            m_nodes.insert(m_nodes.end(), nodes.begin(), nodes.end());
+            m_arc_offsets.push_back(m_nodes.size());
+            m_arc_owners.insert(m_arc_owners.end(), owners.begin(), owners.end());
+            m_arc_owner_offsets.push_back(m_arc_owners.size());
+        }
+
+        /**
+         * Appends a junction to the topology. Junctions have to be added in
+         * ascending order of their ids.
+         *
+         * @param id     The junction node id
+         * @param owners The sorted owners of the junction
+         */
+        template <typename OwnerContainer>
+        void add_junction(object_id_type id, const OwnerContainer& owners)
+        {
+            m_junction_ids.push_back(id);
+            m_junction_owners.insert(m_junction_owners.end(), owners.begin(), owners.end());
+            m_junction_owner_offsets.push_back(m_junction_owners.size());
+        }
+
+        /**
+         * Sets the set of junction node ids.
+         */
+        void set_junctions(id_set_type&& junctions)
+        {
+            m_junctions = std::move(junctions);
+        }
+
+    };
+
+}
@@ -7,6 +7,7 @@
 #include "routine.hpp"
 #include "io/reader/osm_reader.hpp"
 #include "io/writer/osm_writer.hpp"
+#include "io/writer/prepared_writer.hpp"
 
 #include "util/log.hpp"
 #include "util/validate.hpp"
@@ -35,6 +36,11 @@ class Prepare : public Routine
     */
     std::string m_format;
 
+    /**
+     * The number of worker threads.
+     */
+    std::size_t m_threads;
+
     /**
     * The logger.
     */
@@ -49,7 +55,8 @@ public:
         m_options.add_options()
             ("input", po::value<fs::path>()->required(), "Sets the input file path.\nAllowed file formats: .osm, .pbf")
             ("outdir,o", po::value<fs::path>()->default_value(""), "Sets the output directory of the prepared boundaries file. If not set, the file will be stored in the executable directory.")
-            ("format,f", po::value<std::string>()->default_value("osm.pbf"), "Sets the output format.\n Allowed formats: osm, pbf")
+            ("format,f", po::value<std::string>()->default_value("osm.pbf"), "Sets the output format.\n Allowed formats: osm, pbf, wzb (prepared boundaries, which can be loaded faster by the create routine)")
+            ("threads,j", po::value<std::size_t>()->default_value(0), "Sets the number of worker threads.\nIf set to 0, the number of hardware threads will be used.")
             ("help,h", "Shows this help message");
         m_positional.add("input", 1);
     }
@@ -67,6 +74,7 @@ public:
         this->set<fs::path>(&m_input, "input", util::validate_file);
         this->set<fs::path>(&m_outdir, "outdir", m_dir, util::validate_dir);
         this->set<std::string>(&m_format, "format", util::validate_format);
+        this->set<std::size_t>(&m_threads, "threads");
         m_log.set_steps(2);
     }
 
@@ -74,7 +82,7 @@ public:
     {
         // Read the boundaries from the specified input file
         m_log.start() << "Preparing file " << m_input << ".\n";
-        io::BoundaryReader reader{m_input};
+        io::BoundaryReader reader{ m_input, m_threads };
         osmium::memory::Buffer buffer = reader.read();
         m_log.finish();
         
@@ -89,8 +97,16 @@ public:
 
         // Write the boundaries to the output
         m_log.start() << "Writing boundaries to file " << outfile_path << ".\n";
-        io::BoundaryWriter writer{outfile_path};
-        writer.write(std::move(buffer));
+        if (io::prepared::is_prepared(outfile_path))
+        {
+            io::PreparedWriter writer{ outfile_path };
+            writer.write(std::move(buffer));
+        }
+        else
+        {
+            io::BoundaryWriter writer{ outfile_path };
+            writer.write(std::move(buffer));
+        }
         m_log.finish();
 
         m_log.end();
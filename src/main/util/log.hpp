@@ -7,6 +7,8 @@
 #include <string>
 #include <vector>
 
+#include "util/memory.hpp"
+
 namespace util
 {
 
@@ -137,7 +139,8 @@ namespace util
 
         void end()
         {
-            m_stream << "[End] Finished. Total execution time was " << total_duration() << " ms." << std::endl;
+            m_stream << "[End] Finished. Total execution time was " << total_duration() << " ms."
+                     << " Peak memory usage was " << peak_memory() / (1024 * 1024) << " MB." << std::endl;
         }
 
         /* Misc */
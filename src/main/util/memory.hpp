@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace util
+{
+
+    /**
+     * Retrieves the peak resident set size of the current process, which is
+     * the maximum amount of physical memory that the process has used so far.
+     *
+     * @returns The peak memory usage in bytes, or 0 if it could not be
+     *          determined
+     */
+    inline std::size_t peak_memory()
+    {
+#if defined(_WIN32)
+        PROCESS_MEMORY_COUNTERS counters;
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        {
+            return 0;
+        }
+        return counters.PeakWorkingSetSize;
+#else
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+        {
+            return 0;
+        }
+#if defined(__APPLE__)
+        // macOS reports the maximum resident set size in bytes
+        return usage.ru_maxrss;
+#else
+        // Linux reports the maximum resident set size in kilobytes
+        return usage.ru_maxrss * 1024;
+#endif
+#endif
+    }
+
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <set>
+#include <string>
+
+#include <osmium/osm/relation.hpp>
+#include <osmium/osm/way.hpp>
+#include <osmium/tags/taglist.hpp>
+#include <osmium/tags/tags_filter.hpp>
+
+#include "model/types.hpp"
+
+namespace util
+{
+
+    /**
+     * Creates a tag filter that matches the objects with one of the
+     * specified administrative levels.
+     *
+     * @param levels The admin_levels
+     * @returns      The tag filter
+     */
+    inline osmium::TagsFilter level_filter(const std::set<model::level_type>& levels)
+    {
+        osmium::TagsFilter filter{ false };
+        for (const model::level_type& level : levels)
+        {
+            filter.add_rule(true, "admin_level", std::to_string(level));
+        }
+        return filter;
+    }
+
+    /**
+     * Checks if a relation describes a boundary, which is a relation tagged
+     * with type=multipolygon or type=boundary with at least one way member
+     * and tags that match the filter.
+     *
+     * The reader and the assembler use the same check, so that every
+     * relation that is read is assembled as well.
+     *
+     * @param relation The relation
+     * @param filter   The tag filter, such as an admin_level filter
+     * @returns        True if the relation is a boundary
+     */
+    inline bool is_boundary(const osmium::Relation& relation, const osmium::TagsFilter& filter)
+    {
+        const char* type = relation.tags().get_value_by_key("type");
+
+        // Ignore relations without "type" tag
+        if (type == nullptr || (std::strcmp(type, "multipolygon") && std::strcmp(type, "boundary")))
+        {
+            return false;
+        }
+        if (!osmium::tags::match_any_of(relation.tags(), filter))
+        {
+            return false;
+        }
+        return std::any_of(relation.members().cbegin(), relation.members().cend(), [](const osmium::RelationMember& member) {
+            return member.type() == osmium::item_type::way;
+        });
+    }
+
+    /**
+     * Checks if a closed way describes a boundary on its own. At least 4
+     * nodes are needed to make up a polygon.
+     *
+     * The check only compares the node ids of the ends, as the reader has
+     * to decide on the ways before the node locations are known.
+     *
+     * @param way    The way
+     * @param filter The tag filter, such as an admin_level filter
+     * @returns      True if the way is a boundary
+     */
+    inline bool is_area_way(const osmium::Way& way, const osmium::TagsFilter& filter)
+    {
+        return way.nodes().size() > 3
+            && way.is_closed()
+            && !way.tags().has_tag("area", "no")
+            && osmium::tags::match_any_of(way.tags(), filter);
+    }
+
+}
\ No newline at end of file
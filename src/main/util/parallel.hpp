@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace util
+{
+
+    /**
+     * Determines the number of worker threads for a specified thread count.
+     *
+     * @param threads The requested number of threads. If set to 0, the
+     *                number of available hardware threads will be used.
+     * @returns       The number of worker threads, which is at least 1
+     */
+    inline std::size_t thread_count(std::size_t threads)
+    {
+        if (threads == 0)
+        {
+            threads = std::thread::hardware_concurrency();
+        }
+        return std::max(threads, std::size_t(1));
+    }
+
+    /**
+     * Calls a function for each index in the range [0, count) on a specified
+     * number of worker threads. The workers fetch the next index from a
+     * shared counter, so that workers that finish early take over the
+     * remaining work of the others.
+     *
+     * If a call throws an exception, the remaining indices are skipped and
+     * the first exception is rethrown after all workers have finished. The
+     * same applies if a worker thread cannot be created.
+     *
+     * @param count    The number of indices
+     * @param threads  The number of worker threads (0 = auto)
+     * @param function The function, which is called with the index
+     */
+    template <typename Function>
+    void parallel_for(std::size_t count, std::size_t threads, Function&& function)
+    {
+        threads = std::min(thread_count(threads), count);
+        if (threads <= 1)
+        {
+            // Run the calls on the current thread
+            for (std::size_t i = 0; i < count; i++)
+            {
+                function(i);
+            }
+            return;
+        }
+
+        std::atomic<std::size_t> next{ 0 };
+        std::exception_ptr error = nullptr;
+        std::atomic_flag failed = ATOMIC_FLAG_INIT;
+
+        auto worker = [&]()
+        {
+            try
+            {
+                for (std::size_t i = next++; i < count; i = next++)
+                {
+                    function(i);
+                }
+            }
+            catch (...)
+            {
+                // Store the first exception and stop the other workers
+                if (!failed.test_and_set())
+                {
+                    error = std::current_exception();
+                }
+                next = count;
+            }
+        };
+
+        // Start the workers and wait for them to finish. If a thread cannot
+        // be created, the started workers are stopped and joined before the
+        // exception is rethrown, as a joinable thread must not be destroyed.
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        try
+        {
+            for (std::size_t t = 1; t < threads; t++)
+            {
+                workers.emplace_back(worker);
+            }
+        }
+        catch (...)
+        {
+            next = count;
+            for (std::thread& thread : workers)
+            {
+                thread.join();
+            }
+            throw;
+        }
+        worker();
+        for (std::thread& thread : workers)
+        {
+            thread.join();
+        }
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+}
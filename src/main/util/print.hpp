@@ -19,14 +19,29 @@ namespace util
             << "  " << "Format: " << header.format << '\n'
             << "  " << "Compression: " << header.compression << '\n'
             << "  " << "Size: " << header.size << '\n'
-            << "Objects:" << '\n'
-            << "  " << "Nodes: " << header.nodes << '\n'
-            << "  " << "Ways: " << header.ways << '\n'
-            << "  " << "Relations: " << header.relations << '\n'
-            << "Bounding Box:" << '\n'
-            << "  " << "Min: (" << header.bounds.bottom_left().lon() << ", " << header.bounds.bottom_left().lat() << ")" << '\n' 
-            << "  " << "Max: (" << header.bounds.top_right().lon() << ", " << header.bounds.top_right().lat() << ")" << '\n'
-            << "Boundaries: " << '\n'
+            << "Objects:" << '\n';
+        if (header.counted)
+        {
+            stream << "  " << "Nodes: " << header.nodes << '\n'
+                << "  " << "Ways: " << header.ways << '\n';
+        }
+        else
+        {
+            stream << "  " << "Nodes: not counted" << '\n'
+                << "  " << "Ways: not counted" << '\n';
+        }
+        stream << "  " << "Relations: " << header.relations << '\n'
+            << "Bounding Box:" << '\n';
+        if (header.bounds.valid())
+        {
+            stream << "  " << "Min: (" << header.bounds.bottom_left().lon() << ", " << header.bounds.bottom_left().lat() << ")" << '\n' 
+                << "  " << "Max: (" << header.bounds.top_right().lon() << ", " << header.bounds.top_right().lat() << ")" << '\n';
+        }
+        else
+        {
+            stream << "  " << "Unknown" << '\n';
+        }
+        stream << "Boundaries: " << '\n'
             << "  " << "Total: " << header.boundaries << '\n'
             << "  " << "Level Distribution: " << '\n';
         for (const auto& [level, count] : header.levels)
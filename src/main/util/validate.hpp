@@ -18,7 +18,9 @@ namespace util
 
     /* Constants */
 
-    const std::vector<std::string> ALLOWED_OSM_FORMATS{ "osm", "pbf", "osm.pbf" };
+    const std::vector<std::string> ALLOWED_OSM_FORMATS{ "osm", "pbf", "osm.pbf", "wzb" };
+
+    const std::vector<std::string> ALLOWED_HIERARCHY_MODES{ "topology", "geometry" };
 
 
     /* Simple Validation Functions */
@@ -89,6 +91,16 @@ namespace util
         }
     }
 
+    void validate_hierarchy_mode(std::string& mode, std::string name)
+    {
+        if (std::find(ALLOWED_HIERARCHY_MODES.begin(), ALLOWED_HIERARCHY_MODES.end(), mode) == ALLOWED_HIERARCHY_MODES.end())
+        {
+            throw std::invalid_argument(
+                "Invalid mode " + mode + " for parameter '" + name + "'.\nSupported modes are " + util::join(ALLOWED_HIERARCHY_MODES)
+            );
+        }
+    }
+
     void validate_epsilon(double& epsilon, std::string name)
     {
         if (epsilon < 0)